@@ -0,0 +1,191 @@
+// Timed microbenchmarks for the engine's hot paths, printed as JSON.
+//
+// Usage: chessengine_bench [--min-time-ms N] [--filter SUBSTRING]
+//
+// Each benchmark repeats its body until at least the minimum time has elapsed and reports
+// the average cost of one operation. Compare numbers from Release builds only.
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+
+namespace {
+const std::array<const char*, 6> kPositions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+    "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+    "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+// Results feed this sink so the optimizer cannot drop the measured work.
+volatile uint64_t g_sink = 0;
+
+struct BenchResult {
+    std::string name;
+    uint64_t operations = 0;
+    double nanoseconds = 0.0;
+};
+
+// Runs body() (which returns the number of operations it performed) until minTime has
+// passed, after one untimed warm-up call.
+template <typename Body>
+BenchResult Measure(const std::string& name, std::chrono::milliseconds minTime, Body&& body) {
+    body();
+    BenchResult result;
+    result.name = name;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = std::chrono::steady_clock::duration::zero();
+    while (elapsed < minTime) {
+        result.operations += body();
+        elapsed = std::chrono::steady_clock::now() - start;
+    }
+    result.nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    return result;
+}
+
+uint64_t NextKey(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void PrintJson(const std::vector<BenchResult>& results) {
+    std::cout << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        double ns_per_op = r.operations > 0 ? r.nanoseconds / static_cast<double>(r.operations) : 0.0;
+        double ops_per_second = ns_per_op > 0.0 ? 1e9 / ns_per_op : 0.0;
+        std::cout << "    {\"name\": \"" << r.name << "\", \"operations\": " << r.operations
+                  << ", \"ns_per_op\": " << ns_per_op << ", \"ops_per_second\": " << ops_per_second << "}"
+                  << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "  ]\n}\n";
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    std::chrono::milliseconds min_time(500);
+    std::string filter;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--min-time-ms" && i + 1 < argc) {
+            min_time = std::chrono::milliseconds(std::atoi(argv[++i]));
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else {
+            std::cerr << "Usage: chessengine_bench [--min-time-ms N] [--filter SUBSTRING]\n";
+            return 1;
+        }
+    }
+
+    std::vector<Board> boards(kPositions.size());
+    std::vector<MoveList> legal_moves(kPositions.size());
+    for (size_t i = 0; i < kPositions.size(); ++i) {
+        if (!boards[i].LoadFen(kPositions[i])) {
+            std::cerr << "Invalid FEN: " << kPositions[i] << '\n';
+            return 1;
+        }
+        GenerateLegalMoves(boards[i], legal_moves[i]);
+        boards[i].ReserveHistory(16);
+    }
+
+    std::vector<BenchResult> results;
+    auto run = [&](const std::string& name, auto&& body) {
+        if (filter.empty() || name.find(filter) != std::string::npos) {
+            results.push_back(Measure(name, min_time, body));
+        }
+    };
+
+    MoveList moves;
+    run("generate_legal_moves", [&] {
+        for (Board& board : boards) {
+            GenerateLegalMoves(board, moves);
+            g_sink = g_sink + static_cast<uint64_t>(moves.size());
+        }
+        return static_cast<uint64_t>(boards.size());
+    });
+    run("generate_pseudo_legal_moves", [&] {
+        for (const Board& board : boards) {
+            GeneratePseudoLegalMoves(board, moves);
+            g_sink = g_sink + static_cast<uint64_t>(moves.size());
+        }
+        return static_cast<uint64_t>(boards.size());
+    });
+    run("apply_undo_move", [&] {
+        uint64_t operations = 0;
+        for (size_t i = 0; i < boards.size(); ++i) {
+            for (const Move& move : legal_moves[i]) {
+                MoveUndo undo = ApplyMove(boards[i], move);
+                g_sink = g_sink + boards[i].Hash();
+                UndoMoveApply(boards[i], undo);
+                operations += 1;
+            }
+        }
+        return operations;
+    });
+    run("is_square_attacked", [&] {
+        for (const Board& board : boards) {
+            for (int square = 0; square < 64; ++square) {
+                g_sink = g_sink + IsSquareAttacked(board, square, Color::White) +
+                         IsSquareAttacked(board, square, Color::Black);
+            }
+        }
+        return static_cast<uint64_t>(boards.size() * 128);
+    });
+    run("evaluate", [&] {
+        for (const Board& board : boards) {
+            g_sink = g_sink + static_cast<uint64_t>(EvaluateMaterial(board));
+        }
+        return static_cast<uint64_t>(boards.size());
+    });
+
+    const size_t key_count = 1 << 16;
+    std::vector<uint64_t> keys(key_count);
+    uint64_t seed = 0x5EED5EED5EED5EEDULL;
+    for (uint64_t& key : keys) {
+        key = NextKey(seed);
+    }
+    TranspositionTable tt(1 << 20);
+    Move tt_move(12, 28);
+    for (uint64_t key : keys) {
+        tt.Store(key, 4, 17, Bound::EXACT, &tt_move);
+    }
+    run("tt_probe", [&] {
+        for (uint64_t key : keys) {
+            int score = 0;
+            Move move;
+            g_sink = g_sink + tt.Probe(key, 0, -100, 100, score, move);
+        }
+        return static_cast<uint64_t>(keys.size());
+    });
+    // Fresh keys every time, so each store replaces an entry instead of being skipped.
+    run("tt_store", [&] {
+        for (size_t i = 0; i < key_count; ++i) {
+            tt.Store(NextKey(seed), 4, 17, Bound::EXACT, &tt_move);
+        }
+        return static_cast<uint64_t>(key_count);
+    });
+
+    Board fen_board;
+    run("load_fen", [&] {
+        for (const char* fen : kPositions) {
+            g_sink = g_sink + fen_board.LoadFen(fen);
+        }
+        return static_cast<uint64_t>(kPositions.size());
+    });
+
+    PrintJson(results);
+    return 0;
+}
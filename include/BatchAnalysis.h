@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+enum class AnalysisFormat { Csv, Jsonl };
+
+constexpr int kDefaultAnalysisDepth = 8;
+
+struct AnalysisOptions {
+    // Worker threads, each with its own SearchContext.
+    int threads = 1;
+    // Search limits per position; nodes and moveTime of 0 mean no limit.
+    int depth = kDefaultAnalysisDepth;
+    uint64_t nodes = 0;
+    std::chrono::milliseconds moveTime{0};
+    // Total transposition table size, split evenly between the workers.
+    int hashMb = 64;
+    AnalysisFormat format = AnalysisFormat::Csv;
+};
+
+struct AnalysisSummary {
+    int positions = 0;
+    // Lines that could not be parsed as a position.
+    int invalid = 0;
+    uint64_t nodes = 0;
+};
+
+// Streams EPD or FEN lines from in and analyses every position on a pool of workers. Each
+// position is searched from a cleared context, so results do not depend on the thread count
+// or on which worker took the position (except under moveTime). Results (bestmove, score,
+// depth, nodes, pv) are written to out as CSV with a header row or as JSON lines, in input
+// order. Only a bounded window of positions is in flight, so input of any length streams.
+// Invalid lines and the final throughput are reported to log. Blank lines and lines
+// starting with '#' are ignored.
+AnalysisSummary RunBatchAnalysis(std::istream& in, const AnalysisOptions& options, std::ostream& out, std::ostream& log);
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+constexpr int kDefaultBenchDepth = 5;
+
+// Searches a built-in set of positions to a fixed depth, each with a cleared search context,
+// and prints per-position and total nodes, elapsed time and nodes per second. The total node
+// count is deterministic for a given engine and depth and is returned as a signature.
+uint64_t RunBench(int depth, std::ostream& out);
@@ -1,8 +1,16 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <string>
+#include <vector>
+
+// Castling rights bit mask.
+constexpr int kCastleWhiteKingside = 1;
+constexpr int kCastleWhiteQueenside = 2;
+constexpr int kCastleBlackKingside = 4;
+constexpr int kCastleBlackQueenside = 8;
 
 // Square indexing: 0..63 where a1=0, b1=1, ..., h1=7, a2=8, ..., h8=63.
 class Board {
@@ -18,15 +26,45 @@ public:
     void SetSideToMove(char side);
     int EnPassantSquare() const;
     void SetEnPassantSquare(int square);
-    const std::string& CastlingRights() const;
+    std::string CastlingRights() const;
     void SetCastlingRights(const std::string& rights);
+    int CastlingMask() const;
+    void SetCastlingMask(int mask);
+    int HalfmoveClock() const;
+    void SetHalfmoveClock(int clock);
+    int FullmoveNumber() const;
+    void SetFullmoveNumber(int number);
     uint64_t Hash() const;
     void RecomputeHash();
 
+    // Hashes of the positions before each applied move, maintained by ApplyMove/UndoMoveApply.
+    // Reserving ahead of a search keeps make/unmake free of heap allocations.
+    void ReserveHistory(size_t plies);
+    void PushHistory();
+    void PopHistory();
+    size_t HistorySize() const;
+    // Repetition scans stop at this history index. ApplyNullMove raises it to the null move:
+    // positions before a null move cannot recur after it in the same line.
+    size_t RepetitionFloor() const;
+    void SetRepetitionFloor(size_t floor);
+    // True if the current position occurred at least `count` times before, scanning back
+    // only as far as the last irreversible move (halfmove clock) or null move.
+    bool IsRepetition(int count = 1) const;
+    bool IsFiftyMoveDraw() const;
+
 private:
     std::array<char, 64> squares_;
     char side_to_move_;
-    std::string castling_rights_;
+    int castling_mask_;
     int en_passant_square_;
+    int halfmove_clock_;
+    int fullmove_number_;
     uint64_t hash_;
+    std::vector<uint64_t> history_;
+    size_t repetition_floor_;
 };
+
+// Turns a FEN, or the position part of an EPD line (four fields, no move counters, followed
+// by operations such as "bm e4;"), into a full FEN. Returns false if it is not a valid
+// position.
+bool NormalizeFen(const std::string& line, std::string& outFen);
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+
+struct BookBuildOptions {
+    // Worker threads parsing games; the calling thread splits the input between them.
+    int threads = 1;
+    // Only the first maxPly plies of each game go into the book.
+    int maxPly = 24;
+    // (position, move) pairs played in fewer games are left out.
+    int minGames = 2;
+};
+
+struct BookBuildSummary {
+    uint64_t games = 0;
+    // Games whose movetext had an illegal or ambiguous move; their moves up to it are used.
+    uint64_t errors = 0;
+    // Distinct (position, move) pairs seen, and how many of them were written.
+    uint64_t pairs = 0;
+    uint64_t entries = 0;
+};
+
+// Streams PGN games from in and writes an opening book to out (opened in binary mode) in
+// the Polyglot format read by PolyglotBook: 16-byte records sorted by position key, so the
+// result can be memory-mapped and binary-searched as is. Win, draw and loss counts are
+// aggregated per (position, move) on every worker and merged at the end; a move's weight
+// is 2 * wins + draws from the mover's point of view, scaled down per position if it would
+// not fit in 16 bits. The output does not depend on the thread count. Progress and the
+// final summary are reported to log.
+BookBuildSummary BuildBook(std::istream& in, const BookBuildOptions& options, std::ostream& out, std::ostream& log);
@@ -9,8 +9,13 @@ std::optional<std::string> SquareToString(int index);
 
 class Move {
 public:
+    // A default-constructed move is the null move a1a1, used as an empty slot.
+    Move();
     Move(int from_square, int to_square, std::optional<char> promotion = std::nullopt);
 
+    bool operator==(const Move& other) const;
+    bool operator!=(const Move& other) const;
+
     int from() const;
     int to() const;
     std::optional<char> promotion() const;
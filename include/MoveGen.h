@@ -1,7 +1,7 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
-#include <string>
 #include <vector>
 
 #include "Board.h"
@@ -9,6 +9,28 @@
 
 enum class Color { White, Black };
 
+// Upper bound on legal moves in any chess position (218), rounded up.
+constexpr int kMaxMoves = 256;
+
+// Fixed-capacity move buffer used on hot paths instead of std::vector.
+class MoveList {
+public:
+    void push_back(const Move& move) { moves_[size_++] = move; }
+    void clear() { size_ = 0; }
+    int size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    Move& operator[](int index) { return moves_[index]; }
+    const Move& operator[](int index) const { return moves_[index]; }
+    Move* begin() { return moves_.data(); }
+    Move* end() { return moves_.data() + size_; }
+    const Move* begin() const { return moves_.data(); }
+    const Move* end() const { return moves_.data() + size_; }
+
+private:
+    std::array<Move, kMaxMoves> moves_;
+    int size_ = 0;
+};
+
 struct MoveUndo {
     int from;
     int to;
@@ -23,15 +45,33 @@ struct MoveUndo {
     int rook_to;
     char rook_piece;
     bool was_castling;
-    std::string prev_castling_rights;
+    int prev_castling_mask;
+    int prev_halfmove_clock;
+};
+
+struct NullMoveUndo {
+    char side_to_move;
+    int prev_en_passant;
+    int prev_halfmove_clock;
+    size_t prev_repetition_floor;
 };
 
 std::vector<Move> GeneratePseudoLegalMoves(const Board& board);
 std::vector<Move> GenerateLegalMoves(const Board& board);
 uint64_t Perft(const Board& board, int depth);
 
+// Allocation-free variants. The legal generator tests each move with make/unmake on
+// `board` itself and leaves it unchanged on return.
+void GeneratePseudoLegalMoves(const Board& board, MoveList& out);
+void GenerateLegalMoves(Board& board, MoveList& out);
+
 MoveUndo ApplyMove(Board& board, const Move& move);
 void UndoMoveApply(Board& board, const MoveUndo& undo);
 
+// Passes the turn: flips the side to move and clears en passant (hash updated accordingly).
+// The halfmove clock counts it like any other reversible move.
+NullMoveUndo ApplyNullMove(Board& board);
+void UndoNullMove(Board& board, const NullMoveUndo& undo);
+
 bool IsSquareAttacked(const Board& board, int square, Color byColor);
 bool InCheck(const Board& board, Color color);
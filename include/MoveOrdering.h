@@ -0,0 +1,43 @@
+#pragma once
+
+#include <array>
+
+#include "Move.h"
+
+// History entries stay within [-kHistoryMax, kHistoryMax].
+constexpr int kHistoryMax = 16384;
+
+// What the search learns about quiet moves across searches. History is a butterfly table
+// [side][from][to]; counter moves are indexed by the opponent's previous move [from][to].
+// Side 0 is white, 1 is black.
+struct SearchHeuristics {
+    int history[2][64][64];
+    Move counter_moves[64][64];
+};
+
+// Two quiet moves per ply that recently caused a cutoff there, most recent first.
+using KillerMoves = std::array<Move, 2>;
+
+// Ordering score of a quiet move: the killers first, then the counter move to previous
+// (Move() at the root or after a null move), then history. Every score stays below the
+// scores the search gives captures and promotions.
+int QuietMoveScore(const SearchHeuristics& heuristics,
+                   const KillerMoves& killers,
+                   const Move& previous,
+                   int side,
+                   const Move& move);
+
+// History gravity: bonuses shrink as an entry approaches kHistoryMax, keeping it bounded.
+void UpdateHistory(int& entry, int bonus);
+
+// A quiet move caused a beta cutoff at depth: it becomes the first killer and the counter
+// move to previous, and its history grows by the depth bonus.
+void RecordQuietCutoff(SearchHeuristics& heuristics,
+                       KillerMoves& killers,
+                       const Move& previous,
+                       int side,
+                       int depth,
+                       const Move& cutoff);
+
+// A quiet move searched before the one that caused a cutoff at depth loses the same bonus.
+void PenalizeQuietMove(SearchHeuristics& heuristics, int side, int depth, const Move& move);
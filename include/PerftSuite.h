@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+
+struct PerftSuiteOptions {
+    // Depths above this are not run even if the EPD lists them.
+    int maxDepth = 6;
+    // Per-position budget: a deeper depth is not started once its estimated finish (from the
+    // previous depth's time and node growth) would exceed it. 0 means no cap.
+    std::chrono::milliseconds timeCap{0};
+};
+
+struct PerftSuiteResult {
+    int positions = 0;
+    int checked = 0;
+    int failed = 0;
+    int skipped = 0;
+    // Lines that could not be parsed (bad FEN or depth fields).
+    int invalid = 0;
+};
+
+// Reads perft EPD lines ("<fen> ;D1 20 ;D2 400 ..."), verifies every listed depth in
+// ascending order and reports counts, mismatches and nodes per second per position.
+// Blank lines and lines starting with '#' are ignored.
+PerftSuiteResult RunPerftSuite(std::istream& epd, const PerftSuiteOptions& options, std::ostream& out);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Move.h"
+
+struct PgnGame {
+    // Tag pairs in file order.
+    std::vector<std::pair<std::string, std::string>> tags;
+    // The FEN tag if present, else the standard starting position.
+    std::string startFen;
+    // Main line only; comments, NAGs and variations are skipped.
+    std::vector<Move> moves;
+    // "1-0", "0-1", "1/2-1/2" or "*"; empty if the movetext ended without one.
+    std::string result;
+    // First problem in the movetext (bad FEN, illegal or ambiguous SAN). moves holds the
+    // main line up to that point; the rest of the game is skipped.
+    std::string error;
+
+    // The value of the named tag, or an empty string.
+    std::string Tag(const std::string& name) const;
+};
+
+// Reads PGN games one at a time from a stream through a fixed-size buffer, so files of any
+// size are processed in constant memory. SAN moves are resolved against the legal moves
+// of the position they are played in.
+class PgnReader {
+public:
+    explicit PgnReader(std::istream& in);
+
+    // Reads the next game into game; returns false once the input holds no more games.
+    bool Next(PgnGame& game);
+
+    // Resolves only the first plies moves of each game and skips the rest of the movetext
+    // (the result is still read). For callers that only need openings.
+    void SetPlyLimit(size_t plies);
+
+private:
+    int Peek();
+    int Get();
+    void SkipWhitespace();
+    bool ReadTag(PgnGame& game);
+    std::string ReadSymbol();
+
+    static constexpr size_t kBufferSize = 1 << 16;
+    std::istream& in_;
+    std::array<char, kBufferSize> buffer_{};
+    size_t position_ = 0;
+    size_t size_ = 0;
+    size_t ply_limit_ = SIZE_MAX;
+};
+
+// Writes a game as PGN: its tags, then the movetext in SAN with move numbers, wrapped at 80
+// columns and ending with the result ("*" if unknown).
+void WritePgn(const PgnGame& game, std::ostream& out);
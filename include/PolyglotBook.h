@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Board.h"
+#include "Move.h"
+
+// Position key of the Polyglot book format: the XOR of the format's Random64 constants for
+// every piece, each castling right, the en passant file (only when a pawn of the side to move
+// can actually capture there) and white to move. Independent of Board::Hash().
+uint64_t PolyglotKey(const Board& board);
+
+// A legal move in the Polyglot move encoding (castling as the king taking its own rook).
+uint16_t EncodePolyglotMove(const Board& board, const Move& move);
+
+struct BookMove {
+    Move move;
+    int weight = 0;
+};
+
+// A Polyglot .bin opening book: 16-byte big-endian records (key, move, weight, learn) sorted
+// by key. The file is memory-mapped read-only, so opening a book of any size costs neither
+// startup time nor heap, and lookups binary-search the mapping.
+class PolyglotBook {
+public:
+    PolyglotBook() = default;
+    ~PolyglotBook();
+    PolyglotBook(const PolyglotBook&) = delete;
+    PolyglotBook& operator=(const PolyglotBook&) = delete;
+
+    // Maps the file, replacing any open book. Returns false if it cannot be mapped or its size
+    // is not a whole number of records.
+    bool Open(const std::string& path);
+    void Close();
+    bool IsOpen() const;
+    size_t Entries() const;
+
+    // The position's book moves that are legal in it, in file order.
+    std::vector<BookMove> Probe(const Board& board) const;
+
+    // Picks one of the position's book moves with probability proportional to its weight.
+    // Returns false if the position is not in the book or all its weights are zero.
+    bool PickMove(const Board& board, std::mt19937_64& rng, Move& outMove) const;
+
+private:
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+#ifdef _WIN32
+    void* file_ = nullptr;
+    void* mapping_ = nullptr;
+#endif
+};
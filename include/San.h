@@ -0,0 +1,18 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "Board.h"
+#include "Move.h"
+
+// Standard algebraic notation ("Nbd7", "exd6", "e8=Q+", "O-O"). Parsing resolves the text
+// against the legal moves of the position: it returns the unique legal move it describes,
+// or nothing if it matches none or several. Check, mate and annotation suffixes ("+", "#",
+// "!", "?") are accepted and ignored, as are "0-0" castling and a promotion without "=".
+// The board is used for make/unmake legality tests and restored before returning.
+std::optional<Move> ParseSan(Board& board, const std::string& san);
+
+// Formats a legal move with minimal disambiguation and a "+" or "#" suffix. The board is
+// restored before returning.
+std::string MoveToSan(Board& board, const Move& move);
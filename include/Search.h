@@ -1,11 +1,119 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "Board.h"
 #include "Move.h"
+#include "MoveGen.h"
+#include "SearchInstrumentation.h"
+#include "TranspositionTable.h"
+
+constexpr int kMaxSearchDepth = 64;
+constexpr int kMaxMultiPv = 64;
+
+struct SearchStats;
+
+struct SearchLimits {
+    int maxDepth = kMaxSearchDepth;
+    // Stop after exactly this many nodes (quiescence included); 0 means no limit. Without
+    // deadlines the search is then deterministic: the same position and context state (for
+    // example right after Clear()) give the same move, depth and node count on any machine.
+    uint64_t maxNodes = 0;
+    // Number of best lines to find (MultiPV). Each iteration searches the root once per line,
+    // every pass excluding the moves of the lines before it.
+    int multiPv = 1;
+    // Abort point: a running iteration is abandoned and the last completed one is used.
+    std::chrono::steady_clock::time_point hardDeadline = std::chrono::steady_clock::time_point::max();
+    // No new iteration starts once the time since the search began exceeds the budget up to
+    // this point, scaled by SoftTimeScale (best-move stability, fail-lows).
+    std::chrono::steady_clock::time_point softDeadline = std::chrono::steady_clock::time_point::max();
+    // Called on the searching thread after every completed iteration with its score.
+    std::function<void(int score, const SearchStats& stats)> onIteration;
+};
+
+// A move sequence from the root and its score, for the side to move.
+struct PvLine {
+    int score = 0;
+    MoveList pv;
+};
+
+struct SearchStats {
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+    int depth = 0;
+    // Deepest ply reached, quiescence included.
+    int seldepth = 0;
+    // Positions resolved by the endgame tablebase (see Tablebase.h).
+    uint64_t tbhits = 0;
+    // Principal variation of the result, starting with the best move.
+    MoveList pv;
+    // The best lines, best first: one per SearchLimits::multiPv (fewer if there are fewer
+    // legal moves). lines[0] is the principal variation.
+    std::vector<PvLine> lines;
+};
+
+// Owns everything one independent search needs: transposition table, move-ordering
+// heuristics and the per-ply search stack. Contexts share no state, so separate games can
+// search concurrently, each on its own context; a single context is not thread-safe.
+class SearchContext {
+public:
+    explicit SearchContext(size_t ttEntries = 1 << 20);
+    ~SearchContext();
+    SearchContext(const SearchContext&) = delete;
+    SearchContext& operator=(const SearchContext&) = delete;
+
+    int SearchBestMove(Board& board, int depth, Move& outBestMove);
+    int SearchBestMoveTimed(Board& board,
+                            const SearchLimits& limits,
+                            Move& outBestMove,
+                            int& outDepth,
+                            uint64_t& outNodes,
+                            uint64_t& outQNodes);
+    // Equivalent to a hard deadline with no soft limit.
+    int SearchBestMoveTimed(Board& board,
+                            int maxDepth,
+                            std::chrono::steady_clock::time_point deadline,
+                            Move& outBestMove,
+                            int& outDepth,
+                            uint64_t& outNodes,
+                            uint64_t& outQNodes);
+
+    // Asks a running search to finish; safe to call from any thread. The search polls the
+    // flag (and its deadline) every 1024 nodes and returns the result of the last completed
+    // iteration. Each new search clears the flag.
+    void Stop();
+    // Pondering: StartPondering() before a search on the opponent's time suspends its
+    // deadlines; PonderHit() (the expected move was played) restarts the time budget from
+    // that moment. Stop() also ends pondering.
+    void StartPondering();
+    void PonderHit();
+    // Forgets everything learned so far (new game).
+    void Clear();
+    const SearchStats& LastStats() const;
+    // Counters of the last search; all zero unless built with CHESSENGINE_SEARCH_STATS.
+    const SearchInstrumentation& LastInstrumentation() const;
+    TranspositionTable& tt();
+
+private:
+    struct Tables;
+
+    std::unique_ptr<Tables> tables_;
+    SearchStats stats_;
+    std::atomic<bool> stop_requested_{false};
+    std::atomic<bool> pondering_{false};
+};
 
 int EvaluateMaterial(const Board& board);
+// Full moves until mate for a mate score (negative when the side to move is mated), else 0.
+int MateInMoves(int score);
+
+// Convenience wrappers over a process-wide default context.
 int SearchBestMove(Board& board, int depth, Move& outBestMove);
 int SearchBestMoveTimed(Board& board,
                         int maxDepth,
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+// Search instrumentation is compiled in only when CHESSENGINE_SEARCH_STATS is defined (CMake
+// option of the same name). Otherwise every SEARCH_STAT hook expands to nothing, the search
+// carries no counters or timers, and the statistics stay zero.
+#ifdef CHESSENGINE_SEARCH_STATS
+constexpr bool kSearchStatsEnabled = true;
+#define SEARCH_STAT(statement) statement
+#else
+constexpr bool kSearchStatsEnabled = false;
+#define SEARCH_STAT(statement)
+#endif
+
+constexpr int kStatsMaxDepth = 64;
+constexpr int kStatsQsearchDepths = 16;
+
+// Counters for one search on one SearchContext (and so one thread).
+struct SearchInstrumentation {
+    // Transposition table, counted by TranspositionTable itself. A hit is a key match; a
+    // cutoff is a hit whose depth and bound let the probe return a score.
+    uint64_t tt_probes = 0;
+    uint64_t tt_hits = 0;
+    uint64_t tt_cutoffs = 0;
+    uint64_t tt_stores = 0;
+    // Stores that replaced an entry of a different position.
+    uint64_t tt_overwrites = 0;
+    // Beta cutoffs in Negamax, and how many of them the first move produced.
+    uint64_t cutoffs = 0;
+    uint64_t first_move_cutoffs = 0;
+    // Nodes (quiescence included) of each completed iteration, for the branching factor.
+    uint64_t iteration_nodes[kStatsMaxDepth + 1] = {};
+    // Quiescence nodes by distance from the horizon; the last bucket also holds deeper ones.
+    uint64_t qsearch_depth[kStatsQsearchDepths] = {};
+    // Wall time in move generation and evaluation; the rest of total_time is search.
+    std::chrono::nanoseconds movegen_time{0};
+    std::chrono::nanoseconds eval_time{0};
+    std::chrono::nanoseconds total_time{0};
+};
+
+// Adds the lifetime of the object to a time counter.
+class ScopedStatTimer {
+public:
+    explicit ScopedStatTimer(std::chrono::nanoseconds& counter)
+        : counter_(counter), start_(std::chrono::steady_clock::now()) {}
+    ~ScopedStatTimer() { counter_ += std::chrono::steady_clock::now() - start_; }
+    ScopedStatTimer(const ScopedStatTimer&) = delete;
+    ScopedStatTimer& operator=(const ScopedStatTimer&) = delete;
+
+private:
+    std::chrono::nanoseconds& counter_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Writes a short human-readable report, each line starting with linePrefix (for example
+// "info string " in UCI mode).
+void PrintSearchInstrumentation(const SearchInstrumentation& stats,
+                                std::ostream& out,
+                                const std::string& linePrefix = "");
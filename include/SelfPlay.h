@@ -0,0 +1,78 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Search settings for one side of a self-play match. Limits of 0 are off; every move is
+// bounded by all the limits that are set.
+struct EngineConfig {
+    std::string name = "engine";
+    int depth = 0;
+    uint64_t nodes = 0;
+    std::chrono::milliseconds moveTime{0};
+    // Game clock (base time plus increment per move), managed like the console game's.
+    std::chrono::milliseconds baseTime{0};
+    std::chrono::milliseconds increment{0};
+    int hashMb = 16;
+};
+
+// Parses "key=value,..." with keys name, depth, nodes, movetime (ms), tc (seconds, as
+// "base+increment") and hash (MB) into config, starting from its current values.
+bool ParseEngineConfig(const std::string& spec, EngineConfig& config);
+
+// Sequential probability ratio test on the logistic Elo difference of engine A over B:
+// H0 elo = elo0 against H1 elo = elo1, with false positive rate alpha and false negative
+// rate beta.
+struct SprtOptions {
+    bool enabled = true;
+    double elo0 = 0.0;
+    double elo1 = 5.0;
+    double alpha = 0.05;
+    double beta = 0.05;
+};
+
+struct MatchOptions {
+    // Games to play at most; rounded up to whole pairs (each opening once with each color).
+    int games = 100;
+    // Games played at the same time, each on its own thread with two search contexts.
+    int concurrency = 1;
+    // Games still running after this many plies are drawn.
+    int maxPlies = 400;
+    // Ends the game as soon as the side to move reports a forced mate.
+    bool adjudicateMates = true;
+    SprtOptions sprt;
+};
+
+enum class SprtDecision { Continue, AcceptH0, AcceptH1 };
+
+// Results from engine A's point of view.
+struct MatchResult {
+    int games = 0;
+    int wins = 0;
+    int losses = 0;
+    int draws = 0;
+    double elo = 0.0;
+    // Half-width of the 95% confidence interval.
+    double eloMargin = 0.0;
+    double llr = 0.0;
+    double lowerBound = 0.0;
+    double upperBound = 0.0;
+    SprtDecision decision = SprtDecision::Continue;
+};
+
+// Fills the Elo estimate and the SPRT fields of result from its win/loss/draw counts.
+void UpdateMatchStatistics(MatchResult& result, const SprtOptions& sprt);
+
+// Plays engine a against engine b from the given FEN openings, pairing colors: the games of
+// pair i both start from openings[i % size], with a as White in the first. Games are
+// adjudicated on mate, stalemate, repetition, the fifty-move rule, insufficient material,
+// time forfeit and maxPlies. Each finished game and the running score are reported to log.
+// The match stops early once the SPRT accepts a hypothesis.
+MatchResult RunMatch(const std::vector<std::string>& openings,
+                     const EngineConfig& a,
+                     const EngineConfig& b,
+                     const MatchOptions& options,
+                     std::ostream& log);
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Board.h"
+#include "Move.h"
+
+// Game-theoretic result for the side to move.
+enum class Wdl { Loss = -1, Draw = 0, Win = 1 };
+
+// Most pieces, kings included, that ProbeWdl resolves.
+constexpr int kTablebaseMaxPieces = 3;
+
+int CountPieces(const Board& board);
+
+// Exact win/draw/loss for the side to move in positions with at most three pieces. A lone
+// knight or bishop draws. A queen or rook wins unless the defender is to move and either
+// stalemated or able to take the undefended piece. King and pawn against king comes from a
+// bitbase built by retrograde analysis on first use. Returns false for larger positions
+// or positions without exactly one king per side. The fifty-move rule is left to the
+// caller.
+bool ProbeWdl(const Board& board, Wdl& outResult);
+
+// Plies until a won position of at most three pieces ends in mate or in the pawn move that
+// keeps the win, with best play: positive when the side to move wins, negative when it
+// loses and 0 for a draw. Each queen, rook and pawn ending is solved by retrograde analysis
+// on first use. Returns false where ProbeWdl does, and with castling rights.
+bool ProbeDtz(const Board& board, int& outDtz);
+
+// The distance after playing move in board, counted from board, as used to rank root moves:
+// 1 for a mate or a winning pawn move, and the result alone (1, -1 or 0) after a capture.
+bool ProbeMoveDtz(Board& board, const Move& move, int& outDtz);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+
+// Clock state for the side to move, as given by a GUI or the console game.
+struct TimeControl {
+    std::chrono::milliseconds remaining{0};
+    std::chrono::milliseconds increment{0};
+    // Moves until the next time control; 0 means sudden death (or unknown).
+    int movesToGo = 0;
+    // Reserved per move for I/O and scheduling latency.
+    std::chrono::milliseconds moveOverhead{30};
+};
+
+// Soft: iterative deepening should not start a new iteration past this (before scaling).
+// Hard: the search must abort at this point.
+struct TimeBudget {
+    std::chrono::milliseconds soft{0};
+    std::chrono::milliseconds hard{0};
+};
+
+TimeBudget AllocateTime(const TimeControl& control);
+
+// Multiplier applied to the soft budget after each completed iteration. A best move that
+// has survived several iterations stops the search early; a new best move or a root
+// fail-low (score drop) extends it.
+double SoftTimeScale(int stableIterations, bool failedLow);
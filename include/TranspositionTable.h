@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "Move.h"
+#include "SearchInstrumentation.h"
 
 enum class Bound { EXACT, LOWER, UPPER };
 
@@ -16,6 +17,9 @@ struct TTEntry {
     bool hasBestMove = false;
 };
 
+// Largest power-of-two entry count that fits in the given number of megabytes.
+size_t TTEntriesForMegabytes(int megabytes);
+
 class TranspositionTable {
 public:
     explicit TranspositionTable(size_t size_power_of_two);
@@ -29,8 +33,17 @@ public:
                Move& outBestMove) const;
     void Store(uint64_t key, int depth, int score, Bound bound, const Move* bestMove);
     bool PeekBestMove(uint64_t key, Move& outBestMove) const;
+    // Occupied entries per thousand, sampled from the start of the table.
+    int Hashfull() const;
+#ifdef CHESSENGINE_SEARCH_STATS
+    // Probes and stores are counted into stats while it is set (nullptr stops counting).
+    void SetInstrumentation(SearchInstrumentation* stats) { stats_ = stats; }
+#endif
 
 private:
     size_t mask_;
     std::vector<TTEntry> entries_;
+#ifdef CHESSENGINE_SEARCH_STATS
+    SearchInstrumentation* stats_ = nullptr;
+#endif
 };
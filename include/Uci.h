@@ -0,0 +1,8 @@
+#pragma once
+
+#include <iostream>
+
+// Runs the UCI protocol on the given streams until "quit" or end of input. Searches run on
+// a worker thread, so "stop", "ponderhit" and "isready" are answered while searching.
+// Pass handshakeReceived when the caller has already consumed the initial "uci" command.
+int RunUci(std::istream& in, std::ostream& out, bool handshakeReceived = false);
@@ -0,0 +1,331 @@
+#include "BatchAnalysis.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "Search.h"
+#include "TranspositionTable.h"
+
+namespace {
+// Positions in flight per worker: enough to keep every worker busy while the output waits
+// for a slow position, without reading the whole input ahead.
+const size_t kWindowPerWorker = 4;
+
+struct AnalysisJob {
+    size_t index = 0;
+    std::string id;
+    std::string fen;
+};
+
+struct AnalysisRecord {
+    size_t index = 0;
+    std::string id;
+    std::string fen;
+    std::string best_move;
+    int score = 0;
+    int depth = 0;
+    int seldepth = 0;
+    uint64_t nodes = 0;
+    long long time_ms = 0;
+    std::string pv;
+};
+
+std::string Trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Splits the operations after the four position fields of an EPD line into words, opcode
+// first. An operation ends at a ';' outside quotes; a quoted operand is one word, without
+// its quotes and with backslash escapes resolved.
+std::vector<std::vector<std::string>> EpdOperations(const std::string& line) {
+    size_t pos = 0;
+    for (int field = 0; field < 4 && pos < line.size(); ++field) {
+        pos = line.find_first_not_of(" \t", pos);
+        pos = pos == std::string::npos ? pos : line.find_first_of(" \t;", pos);
+    }
+    std::vector<std::vector<std::string>> operations(1);
+    std::string word;
+    bool in_word = false;
+    bool quoted = false;
+    for (size_t i = pos; i < line.size(); ++i) {
+        char c = line[i];
+        if (quoted) {
+            if (c == '\\' && i + 1 < line.size()) {
+                word += line[++i];
+            } else if (c == '"') {
+                quoted = false;
+            } else {
+                word += c;
+            }
+        } else if (c == '"') {
+            quoted = true;
+            in_word = true;
+        } else if (c == ';' || c == ' ' || c == '\t' || c == '\r') {
+            if (in_word) {
+                operations.back().push_back(word);
+                word.clear();
+                in_word = false;
+            }
+            if (c == ';') {
+                operations.emplace_back();
+            }
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (in_word) {
+        operations.back().push_back(word);
+    }
+    return operations;
+}
+
+// Accepts a FEN or an EPD line, taking the name from an "id" operation if there is one.
+bool ParseLine(const std::string& line, AnalysisJob& job) {
+    if (!NormalizeFen(line, job.fen)) {
+        return false;
+    }
+    for (const std::vector<std::string>& operation : EpdOperations(line)) {
+        if (operation.size() > 1 && operation[0] == "id") {
+            job.id = operation[1];
+            break;
+        }
+    }
+    return true;
+}
+
+AnalysisRecord Analyze(SearchContext& context, const AnalysisJob& job, const AnalysisOptions& options) {
+    AnalysisRecord record;
+    record.index = job.index;
+    record.id = job.id;
+    record.fen = job.fen;
+
+    context.Clear();
+    Board board;
+    board.LoadFen(job.fen);
+    auto start = std::chrono::steady_clock::now();
+    SearchLimits limits;
+    limits.maxDepth = std::clamp(options.depth, 1, kMaxSearchDepth);
+    limits.maxNodes = options.nodes;
+    if (options.moveTime.count() > 0) {
+        limits.hardDeadline = start + options.moveTime;
+    }
+    Move best;
+    uint64_t nodes = 0;
+    uint64_t qnodes = 0;
+    record.score = context.SearchBestMoveTimed(board, limits, best, record.depth, nodes, qnodes);
+    record.time_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    record.nodes = nodes + qnodes;
+
+    std::vector<Move> legal = GenerateLegalMoves(board);
+    if (legal.empty()) {
+        record.best_move = "0000";
+        return record;
+    }
+    // A limit too small for one iteration still yields a legal move.
+    record.best_move = record.depth > 0 ? best.ToUci() : legal.front().ToUci();
+    const SearchStats& stats = context.LastStats();
+    record.seldepth = stats.seldepth;
+    for (const Move& move : stats.pv) {
+        record.pv += record.pv.empty() ? move.ToUci() : " " + move.ToUci();
+    }
+    return record;
+}
+
+std::string CsvField(const std::string& text) {
+    if (text.find_first_of(",\"") == std::string::npos) {
+        return text;
+    }
+    std::string quoted = "\"";
+    for (char c : text) {
+        quoted += c == '"' ? "\"\"" : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+// Escapes quotes, backslashes and control characters, which JSON does not allow raw.
+std::string JsonString(const std::string& text) {
+    static const char kHex[] = "0123456789abcdef";
+    std::string quoted = "\"";
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+            quoted += c;
+        } else if (c == '\n') {
+            quoted += "\\n";
+        } else if (c == '\r') {
+            quoted += "\\r";
+        } else if (c == '\t') {
+            quoted += "\\t";
+        } else if (byte < 0x20) {
+            quoted += "\\u00";
+            quoted += kHex[byte >> 4];
+            quoted += kHex[byte & 0xF];
+        } else {
+            quoted += c;
+        }
+    }
+    return quoted + "\"";
+}
+
+void WriteRecord(const AnalysisRecord& record, AnalysisFormat format, std::ostream& out) {
+    int mate = MateInMoves(record.score);
+    if (format == AnalysisFormat::Csv) {
+        out << record.index << ',' << CsvField(record.id) << ',' << record.fen << ',' << record.best_move << ','
+            << record.score << ',' << mate << ',' << record.depth << ',' << record.seldepth << ',' << record.nodes
+            << ',' << record.time_ms << ',' << record.pv << '\n';
+    } else {
+        out << "{\"index\":" << record.index << ",\"id\":" << JsonString(record.id)
+            << ",\"fen\":" << JsonString(record.fen) << ",\"bestmove\":\"" << record.best_move
+            << "\",\"score\":" << record.score << ",\"mate\":" << mate << ",\"depth\":" << record.depth
+            << ",\"seldepth\":" << record.seldepth << ",\"nodes\":" << record.nodes << ",\"time_ms\":" << record.time_ms
+            << ",\"pv\":\"" << record.pv << "\"}\n";
+    }
+}
+
+// Jobs flow from the reading thread to the workers through queue; results come back through
+// finished, keyed by input index, and are written once every earlier result is out.
+class AnalysisPool {
+public:
+    explicit AnalysisPool(const AnalysisOptions& options) : options_(options) {
+        int threads = std::max(options.threads, 1);
+        size_t tt_entries = TTEntriesForMegabytes(std::max(options.hashMb / threads, 1));
+        for (int i = 0; i < threads; ++i) {
+            contexts_.push_back(std::make_unique<SearchContext>(tt_entries));
+        }
+        for (int i = 0; i < threads; ++i) {
+            workers_.emplace_back([this, i] { Work(*contexts_[i]); });
+        }
+    }
+
+    ~AnalysisPool() {
+        Close();
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void Submit(AnalysisJob job) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(job));
+        work_ready_.notify_one();
+    }
+
+    void Close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+        work_ready_.notify_all();
+    }
+
+    // Waits for the result with the given index.
+    AnalysisRecord Take(size_t index) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        result_ready_.wait(lock, [&] { return finished_.count(index) > 0; });
+        auto found = finished_.find(index);
+        AnalysisRecord record = std::move(found->second);
+        finished_.erase(found);
+        return record;
+    }
+
+private:
+    void Work(SearchContext& context) {
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            AnalysisJob job = std::move(queue_.front());
+            queue_.pop_front();
+            lock.unlock();
+
+            AnalysisRecord record = Analyze(context, job, options_);
+
+            lock.lock();
+            finished_.emplace(record.index, std::move(record));
+            result_ready_.notify_all();
+        }
+    }
+
+    const AnalysisOptions& options_;
+    std::vector<std::unique_ptr<SearchContext>> contexts_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable result_ready_;
+    std::deque<AnalysisJob> queue_;
+    std::map<size_t, AnalysisRecord> finished_;
+    bool closed_ = false;
+};
+}  // namespace
+
+AnalysisSummary RunBatchAnalysis(std::istream& in, const AnalysisOptions& options, std::ostream& out, std::ostream& log) {
+    AnalysisSummary summary;
+    auto start = std::chrono::steady_clock::now();
+    if (options.format == AnalysisFormat::Csv) {
+        out << "index,id,fen,bestmove,score,mate,depth,seldepth,nodes,time_ms,pv\n";
+    }
+
+    AnalysisPool pool(options);
+    const size_t window = kWindowPerWorker * static_cast<size_t>(std::max(options.threads, 1));
+    size_t submitted = 0;
+    size_t written = 0;
+    int line_number = 0;
+    bool end_of_input = false;
+    std::string line;
+    while (!end_of_input || written < submitted) {
+        while (!end_of_input && submitted - written < window) {
+            if (!std::getline(in, line)) {
+                end_of_input = true;
+                pool.Close();
+                break;
+            }
+            line_number += 1;
+            line = Trim(line);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            AnalysisJob job;
+            if (!ParseLine(line, job)) {
+                log << "line " << line_number << ": invalid position: " << line << '\n';
+                summary.invalid += 1;
+                continue;
+            }
+            job.index = ++submitted;
+            pool.Submit(std::move(job));
+        }
+        if (written < submitted) {
+            AnalysisRecord record = pool.Take(written + 1);
+            WriteRecord(record, options.format, out);
+            summary.positions += 1;
+            summary.nodes += record.nodes;
+            written += 1;
+        }
+    }
+    out.flush();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log << std::fixed << std::setprecision(2) << "Analysed " << summary.positions << " positions (" << summary.invalid
+        << " invalid) in " << seconds << " s with " << std::max(options.threads, 1) << " threads: "
+        << (seconds > 0.0 ? summary.positions / seconds : 0.0) << " positions/s, "
+        << static_cast<uint64_t>(seconds > 0.0 ? static_cast<double>(summary.nodes) / seconds : 0.0) << " nps\n";
+    return summary;
+}
@@ -1,5 +1,6 @@
 #include "Board.h"
 
+#include <algorithm>
 #include <cctype>
 #include <sstream>
 
@@ -70,22 +71,22 @@ int PieceIndex(char piece) {
     }
 }
 
-int CastlingMask(const std::string& rights) {
+int ParseCastlingMask(const std::string& rights) {
     if (rights == "-" || rights.empty()) {
         return 0;
     }
     int mask = 0;
     if (rights.find('K') != std::string::npos) {
-        mask |= 1;
+        mask |= kCastleWhiteKingside;
     }
     if (rights.find('Q') != std::string::npos) {
-        mask |= 2;
+        mask |= kCastleWhiteQueenside;
     }
     if (rights.find('k') != std::string::npos) {
-        mask |= 4;
+        mask |= kCastleBlackKingside;
     }
     if (rights.find('q') != std::string::npos) {
-        mask |= 8;
+        mask |= kCastleBlackQueenside;
     }
     return mask;
 }
@@ -110,6 +111,24 @@ bool IsPieceChar(char c) {
     }
 }
 
+bool ParseCounter(const std::string& text, int minimum, int& out) {
+    if (text.empty() || text.size() > 6) {
+        return false;
+    }
+    int value = 0;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    if (value < minimum) {
+        return false;
+    }
+    out = value;
+    return true;
+}
+
 bool IsCastlingChar(char c) {
     return c == 'K' || c == 'Q' || c == 'k' || c == 'q';
 }
@@ -149,9 +168,12 @@ const char* PieceToSymbol(char piece) {
 Board::Board()
     : squares_(),
       side_to_move_('w'),
-      castling_rights_("-"),
+      castling_mask_(0),
       en_passant_square_(-1),
-      hash_(0) {
+      halfmove_clock_(0),
+      fullmove_number_(1),
+      hash_(0),
+      repetition_floor_(0) {
     squares_.fill('.');
     RecomputeHash();
 }
@@ -159,8 +181,12 @@ Board::Board()
 bool Board::LoadFen(const std::string& fen) {
     squares_.fill('.');
     side_to_move_ = 'w';
-    castling_rights_ = "-";
+    castling_mask_ = 0;
     en_passant_square_ = -1;
+    halfmove_clock_ = 0;
+    fullmove_number_ = 1;
+    history_.clear();
+    repetition_floor_ = 0;
 
     std::istringstream iss(fen);
     std::string board_part;
@@ -217,7 +243,7 @@ bool Board::LoadFen(const std::string& fen) {
             }
             seen.push_back(c);
         }
-        castling_rights_ = castling_part;
+        castling_mask_ = ParseCastlingMask(castling_part);
     }
 
     if (en_passant_part != "-") {
@@ -228,6 +254,18 @@ bool Board::LoadFen(const std::string& fen) {
         en_passant_square_ = *square;
     }
 
+    // Halfmove clock and fullmove number are optional; when present they must be valid.
+    std::string halfmove_part;
+    std::string fullmove_part;
+    if (iss >> halfmove_part) {
+        if (!ParseCounter(halfmove_part, 0, halfmove_clock_)) {
+            return false;
+        }
+        if (iss >> fullmove_part && !ParseCounter(fullmove_part, 1, fullmove_number_)) {
+            return false;
+        }
+    }
+
     RecomputeHash();
     return true;
 }
@@ -318,20 +356,59 @@ void Board::SetEnPassantSquare(int square) {
     }
 }
 
-const std::string& Board::CastlingRights() const {
-    return castling_rights_;
+std::string Board::CastlingRights() const {
+    std::string rights;
+    if (castling_mask_ & kCastleWhiteKingside) {
+        rights.push_back('K');
+    }
+    if (castling_mask_ & kCastleWhiteQueenside) {
+        rights.push_back('Q');
+    }
+    if (castling_mask_ & kCastleBlackKingside) {
+        rights.push_back('k');
+    }
+    if (castling_mask_ & kCastleBlackQueenside) {
+        rights.push_back('q');
+    }
+    return rights.empty() ? "-" : rights;
 }
 
 void Board::SetCastlingRights(const std::string& rights) {
+    SetCastlingMask(ParseCastlingMask(rights));
+}
+
+int Board::CastlingMask() const {
+    return castling_mask_;
+}
+
+void Board::SetCastlingMask(int mask) {
+    if (mask < 0 || mask > 15 || mask == castling_mask_) {
+        return;
+    }
     InitZobrist();
-    int old_mask = CastlingMask(castling_rights_);
-    std::string normalized = rights.empty() ? "-" : rights;
-    int new_mask = CastlingMask(normalized);
-    if (old_mask != new_mask) {
-        hash_ ^= zobrist_castling_keys[old_mask];
-        hash_ ^= zobrist_castling_keys[new_mask];
+    hash_ ^= zobrist_castling_keys[castling_mask_];
+    hash_ ^= zobrist_castling_keys[mask];
+    castling_mask_ = mask;
+}
+
+int Board::HalfmoveClock() const {
+    return halfmove_clock_;
+}
+
+void Board::SetHalfmoveClock(int clock) {
+    if (clock >= 0) {
+        halfmove_clock_ = clock;
+    }
+}
+
+int Board::FullmoveNumber() const {
+    return fullmove_number_;
+}
+
+void Board::SetFullmoveNumber(int number) {
+    if (number >= 1) {
+        fullmove_number_ = number;
     }
-    castling_rights_ = normalized;
 }
 
 uint64_t Board::Hash() const {
@@ -350,10 +427,82 @@ void Board::RecomputeHash() {
     if (side_to_move_ == 'b') {
         hash_ ^= zobrist_side_key;
     }
-    int mask = CastlingMask(castling_rights_);
-    hash_ ^= zobrist_castling_keys[mask];
+    hash_ ^= zobrist_castling_keys[castling_mask_];
     if (en_passant_square_ != -1) {
         int file = en_passant_square_ % 8;
         hash_ ^= zobrist_enpassant_file_keys[file];
     }
 }
+
+void Board::ReserveHistory(size_t plies) {
+    history_.reserve(history_.size() + plies);
+}
+
+void Board::PushHistory() {
+    history_.push_back(hash_);
+}
+
+void Board::PopHistory() {
+    if (!history_.empty()) {
+        history_.pop_back();
+    }
+}
+
+size_t Board::HistorySize() const {
+    return history_.size();
+}
+
+size_t Board::RepetitionFloor() const {
+    return repetition_floor_;
+}
+
+void Board::SetRepetitionFloor(size_t floor) {
+    repetition_floor_ = floor;
+}
+
+bool Board::IsRepetition(int count) const {
+    // Only positions with the same side to move can repeat, so step back two plies at a time.
+    int size = static_cast<int>(history_.size());
+    int oldest = std::max(std::max(size - halfmove_clock_, static_cast<int>(repetition_floor_)), 0);
+    int found = 0;
+    for (int i = size - 2; i >= oldest; i -= 2) {
+        if (history_[i] == hash_) {
+            found += 1;
+            if (found >= count) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool Board::IsFiftyMoveDraw() const {
+    return halfmove_clock_ >= 100;
+}
+
+bool NormalizeFen(const std::string& line, std::string& outFen) {
+    std::istringstream fields(line.substr(0, line.find(';')));
+    std::vector<std::string> tokens;
+    std::string token;
+    while (tokens.size() < 6 && fields >> token) {
+        tokens.push_back(token);
+    }
+    if (tokens.size() < 4) {
+        return false;
+    }
+    auto is_number = [](const std::string& text) {
+        return std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+    };
+    std::string fen = tokens[0] + " " + tokens[1] + " " + tokens[2] + " " + tokens[3];
+    if (tokens.size() == 6 && is_number(tokens[4]) && is_number(tokens[5])) {
+        fen += " " + tokens[4] + " " + tokens[5];
+    } else {
+        fen += " 0 1";
+    }
+    Board board;
+    if (!board.LoadFen(fen)) {
+        return false;
+    }
+    outFen = fen;
+    return true;
+}
@@ -0,0 +1,272 @@
+#include "BookBuilder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "Pgn.h"
+#include "PolyglotBook.h"
+
+namespace {
+// Games handed to a worker at a time, and chunks in flight per worker: large enough to keep
+// the queue cheap, small enough that the input streams in constant memory.
+const size_t kGamesPerChunk = 256;
+const size_t kChunksPerWorker = 2;
+const uint64_t kMaxWeight = 65535;
+
+struct PairKey {
+    uint64_t key = 0;
+    uint16_t move = 0;
+
+    bool operator==(const PairKey& other) const { return key == other.key && move == other.move; }
+};
+
+struct PairKeyHash {
+    size_t operator()(const PairKey& pair) const {
+        return static_cast<size_t>(pair.key ^ (static_cast<uint64_t>(pair.move) * 0x9E3779B97F4A7C15ULL));
+    }
+};
+
+struct PairStats {
+    uint64_t games = 0;
+    uint64_t wins = 0;
+    uint64_t draws = 0;
+    uint64_t losses = 0;
+};
+
+using PairMap = std::unordered_map<PairKey, PairStats, PairKeyHash>;
+
+struct WorkerTotals {
+    PairMap pairs;
+    uint64_t games = 0;
+    uint64_t errors = 0;
+};
+
+struct BookRecord {
+    uint64_t key = 0;
+    uint16_t move = 0;
+    uint16_t weight = 0;
+};
+
+// Adds the opening of one game: every position up to maxPly with the move played in it,
+// scored from the mover's point of view.
+void AddGame(const PgnGame& game, int maxPly, PairMap& pairs) {
+    Board board;
+    if (!board.LoadFen(game.startFen)) {
+        return;
+    }
+    int white_score = game.result == "1-0" ? 1 : game.result == "0-1" ? -1 : 0;
+    bool decided = game.result == "1-0" || game.result == "0-1" || game.result == "1/2-1/2";
+    size_t plies = std::min(game.moves.size(), static_cast<size_t>(std::max(maxPly, 0)));
+    for (size_t i = 0; i < plies; ++i) {
+        const Move& move = game.moves[i];
+        PairStats& stats = pairs[PairKey{PolyglotKey(board), EncodePolyglotMove(board, move)}];
+        stats.games += 1;
+        if (decided) {
+            int score = board.SideToMove() == 'w' ? white_score : -white_score;
+            stats.wins += score > 0 ? 1 : 0;
+            stats.draws += score == 0 ? 1 : 0;
+            stats.losses += score < 0 ? 1 : 0;
+        }
+        MoveUndo undo = ApplyMove(board, move);
+        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    }
+}
+
+// Chunks of game text flow from the reading thread to the workers; each worker aggregates
+// into its own map, so the only shared state is the queue.
+class BookPool {
+public:
+    explicit BookPool(const BookBuildOptions& options)
+        : options_(options), totals_(static_cast<size_t>(std::max(options.threads, 1))) {
+        for (size_t i = 0; i < totals_.size(); ++i) {
+            workers_.emplace_back([this, i] { Work(totals_[i]); });
+        }
+    }
+
+    ~BookPool() { Finish(); }
+
+    // Blocks while the queue is full.
+    void Submit(std::string chunk) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_ready_.wait(lock, [this] { return queue_.size() < kChunksPerWorker * totals_.size(); });
+        queue_.push_back(std::move(chunk));
+        work_ready_.notify_one();
+    }
+
+    // Waits for the workers to drain the queue and returns their totals.
+    std::vector<WorkerTotals>& Finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            work_ready_.notify_all();
+        }
+        for (std::thread& worker : workers_) {
+            worker.join();
+        }
+        workers_.clear();
+        return totals_;
+    }
+
+private:
+    void Work(WorkerTotals& totals) {
+        while (true) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this] { return closed_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            std::string chunk = std::move(queue_.front());
+            queue_.pop_front();
+            space_ready_.notify_one();
+            lock.unlock();
+
+            std::istringstream text(chunk);
+            PgnReader reader(text);
+            reader.SetPlyLimit(static_cast<size_t>(std::max(options_.maxPly, 0)));
+            PgnGame game;
+            while (reader.Next(game)) {
+                totals.games += 1;
+                totals.errors += game.error.empty() ? 0 : 1;
+                AddGame(game, options_.maxPly, totals.pairs);
+            }
+        }
+    }
+
+    const BookBuildOptions& options_;
+    std::vector<WorkerTotals> totals_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable space_ready_;
+    std::deque<std::string> queue_;
+    bool closed_ = false;
+};
+
+void WriteBigEndian(std::ostream& out, uint64_t value, int bytes) {
+    char buffer[8];
+    for (int i = 0; i < bytes; ++i) {
+        buffer[i] = static_cast<char>(value >> (8 * (bytes - 1 - i)));
+    }
+    out.write(buffer, bytes);
+}
+}  // namespace
+
+BookBuildSummary BuildBook(std::istream& in, const BookBuildOptions& options, std::ostream& out, std::ostream& log) {
+    BookBuildSummary summary;
+    auto start = std::chrono::steady_clock::now();
+
+    // Chunks are cut only in front of a tag line that follows movetext, which is where the
+    // PGN reader itself would start the next game.
+    BookPool pool(options);
+    std::string chunk;
+    size_t chunk_games = 0;
+    bool in_movetext = false;
+    std::string line;
+    while (std::getline(in, line)) {
+        bool tag = !line.empty() && line[0] == '[';
+        if (tag && in_movetext) {
+            in_movetext = false;
+            chunk_games += 1;
+            if (chunk_games == kGamesPerChunk) {
+                pool.Submit(std::move(chunk));
+                chunk.clear();
+                chunk_games = 0;
+            }
+        } else if (!tag && line.find_first_not_of(" \t\r") != std::string::npos) {
+            in_movetext = true;
+        }
+        chunk += line;
+        chunk += '\n';
+    }
+    if (!chunk.empty()) {
+        pool.Submit(std::move(chunk));
+    }
+
+    std::vector<WorkerTotals>& totals = pool.Finish();
+    PairMap& merged = totals.front().pairs;
+    for (size_t i = 0; i < totals.size(); ++i) {
+        summary.games += totals[i].games;
+        summary.errors += totals[i].errors;
+        if (i == 0) {
+            continue;
+        }
+        for (const auto& [pair, stats] : totals[i].pairs) {
+            PairStats& target = merged[pair];
+            target.games += stats.games;
+            target.wins += stats.wins;
+            target.draws += stats.draws;
+            target.losses += stats.losses;
+        }
+        totals[i].pairs = PairMap();
+    }
+    summary.pairs = merged.size();
+
+    std::vector<BookRecord> records;
+    std::vector<uint64_t> points;
+    for (const auto& [pair, stats] : merged) {
+        if (stats.games < static_cast<uint64_t>(std::max(options.minGames, 1))) {
+            continue;
+        }
+        records.push_back({pair.key, pair.move, 0});
+        points.push_back(2 * stats.wins + stats.draws);
+    }
+    PairMap().swap(merged);
+
+    // Sort by key, then by points (best first, the order book tools expect), then by move so
+    // that the file is identical for any thread count.
+    std::vector<size_t> order(records.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (records[a].key != records[b].key) {
+            return records[a].key < records[b].key;
+        }
+        if (points[a] != points[b]) {
+            return points[a] > points[b];
+        }
+        return records[a].move < records[b].move;
+    });
+    for (size_t first = 0; first < order.size();) {
+        size_t last = first;
+        while (last < order.size() && records[order[last]].key == records[order[first]].key) {
+            last += 1;
+        }
+        uint64_t best = points[order[first]];
+        for (size_t i = first; i < last; ++i) {
+            uint64_t weight = points[order[i]];
+            if (best > kMaxWeight) {
+                weight = weight * kMaxWeight / best;
+            }
+            records[order[i]].weight = static_cast<uint16_t>(weight);
+        }
+        first = last;
+    }
+    for (size_t index : order) {
+        const BookRecord& record = records[index];
+        WriteBigEndian(out, record.key, 8);
+        WriteBigEndian(out, record.move, 2);
+        WriteBigEndian(out, record.weight, 2);
+        WriteBigEndian(out, 0, 4);
+    }
+    out.flush();
+    summary.entries = records.size();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    log << std::fixed << std::setprecision(2) << "Read " << summary.games << " games (" << summary.errors
+        << " with errors) in " << seconds << " s with " << std::max(options.threads, 1) << " threads: "
+        << (seconds > 0.0 ? summary.games / seconds : 0.0) << " games/s; wrote " << summary.entries << " of "
+        << summary.pairs << " position/move pairs\n";
+    return summary;
+}
@@ -41,9 +41,20 @@ std::optional<std::string> SquareToString(int index) {
     return text;
 }
 
+Move::Move() : Move(0, 0) {}
+
 Move::Move(int from_square, int to_square, std::optional<char> promotion)
     : from_square_(from_square), to_square_(to_square), promotion_(promotion) {}
 
+bool Move::operator==(const Move& other) const {
+    return from_square_ == other.from_square_ && to_square_ == other.to_square_ &&
+           promotion_ == other.promotion_;
+}
+
+bool Move::operator!=(const Move& other) const {
+    return !(*this == other);
+}
+
 int Move::from() const {
     return from_square_;
 }
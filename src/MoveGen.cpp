@@ -23,12 +23,12 @@ bool IsEnemy(char piece, char side) {
     return IsWhitePiece(piece);
 }
 
-void AddMove(std::vector<Move>& moves, int from, int to, std::optional<char> promotion = std::nullopt) {
-    moves.emplace_back(from, to, promotion);
+void AddMove(MoveList& moves, int from, int to, std::optional<char> promotion = std::nullopt) {
+    moves.push_back(Move(from, to, promotion));
 }
 
 void AddSlidingMoves(const Board& board,
-                     std::vector<Move>& moves,
+                     MoveList& moves,
                      int from,
                      char side,
                      int file_delta,
@@ -53,7 +53,7 @@ void AddSlidingMoves(const Board& board,
     }
 }
 
-void AddKnightMoves(const Board& board, std::vector<Move>& moves, int from, char side) {
+void AddKnightMoves(const Board& board, MoveList& moves, int from, char side) {
     const int file = from % 8;
     const int rank = from / 8;
     const int offsets[8][2] = {
@@ -74,7 +74,7 @@ void AddKnightMoves(const Board& board, std::vector<Move>& moves, int from, char
     }
 }
 
-void AddKingMoves(const Board& board, std::vector<Move>& moves, int from, char side) {
+void AddKingMoves(const Board& board, MoveList& moves, int from, char side) {
     const int file = from % 8;
     const int rank = from / 8;
     for (int df = -1; df <= 1; ++df) {
@@ -96,7 +96,7 @@ void AddKingMoves(const Board& board, std::vector<Move>& moves, int from, char s
     }
 }
 
-void AddPawnMoves(const Board& board, std::vector<Move>& moves, int from, char side) {
+void AddPawnMoves(const Board& board, MoveList& moves, int from, char side) {
     int file = from % 8;
     int rank = from / 8;
     int ep_square = board.EnPassantSquare();
@@ -229,16 +229,23 @@ int FindKingSquare(const Board& board, Color color) {
     return -1;
 }
 
-void RemoveCastlingRight(std::string& rights, char right) {
-    if (rights == "-") {
-        rights.clear();
-    }
-    auto pos = rights.find(right);
-    if (pos != std::string::npos) {
-        rights.erase(pos, 1);
-    }
-    if (rights.empty()) {
-        rights = "-";
+// Castling rights that survive a move touching `square` (king or rook home squares).
+int CastlingRightsKept(int square) {
+    switch (square) {
+        case 0:
+            return ~kCastleWhiteQueenside;
+        case 4:
+            return ~(kCastleWhiteKingside | kCastleWhiteQueenside);
+        case 7:
+            return ~kCastleWhiteKingside;
+        case 56:
+            return ~kCastleBlackQueenside;
+        case 60:
+            return ~(kCastleBlackKingside | kCastleBlackQueenside);
+        case 63:
+            return ~kCastleBlackKingside;
+        default:
+            return ~0;
     }
 }
 
@@ -251,7 +258,7 @@ MoveUndo ApplyMove(Board& board, const Move& move) {
     char captured = board.PieceAt(to);
     char side = board.SideToMove();
     int prev_ep = board.EnPassantSquare();
-    std::string prev_castling = board.CastlingRights();
+    int prev_castling = board.CastlingMask();
     int ep_capture_square = -1;
     char ep_captured = '.';
     bool was_en_passant = false;
@@ -259,7 +266,9 @@ MoveUndo ApplyMove(Board& board, const Move& move) {
     int rook_to = -1;
     char rook_piece = '.';
     bool was_castling = false;
+    int prev_halfmove = board.HalfmoveClock();
 
+    board.PushHistory();
     board.SetEnPassantSquare(-1);
 
     if ((moved == 'P' || moved == 'p') && to == prev_ep && captured == '.') {
@@ -278,53 +287,8 @@ MoveUndo ApplyMove(Board& board, const Move& move) {
     board.SetPieceAt(to, placed);
     board.SetPieceAt(from, '.');
 
-    if ((moved == 'K' && from == 4) || (moved == 'k' && from == 60)) {
-        std::string rights = board.CastlingRights();
-        if (moved == 'K') {
-            RemoveCastlingRight(rights, 'K');
-            RemoveCastlingRight(rights, 'Q');
-        } else {
-            RemoveCastlingRight(rights, 'k');
-            RemoveCastlingRight(rights, 'q');
-        }
-        board.SetCastlingRights(rights);
-    }
-
-    if (moved == 'R') {
-        std::string rights = board.CastlingRights();
-        if (from == 0) {
-            RemoveCastlingRight(rights, 'Q');
-        } else if (from == 7) {
-            RemoveCastlingRight(rights, 'K');
-        }
-        board.SetCastlingRights(rights);
-    } else if (moved == 'r') {
-        std::string rights = board.CastlingRights();
-        if (from == 56) {
-            RemoveCastlingRight(rights, 'q');
-        } else if (from == 63) {
-            RemoveCastlingRight(rights, 'k');
-        }
-        board.SetCastlingRights(rights);
-    }
-
-    if (captured == 'R') {
-        std::string rights = board.CastlingRights();
-        if (to == 0) {
-            RemoveCastlingRight(rights, 'Q');
-        } else if (to == 7) {
-            RemoveCastlingRight(rights, 'K');
-        }
-        board.SetCastlingRights(rights);
-    } else if (captured == 'r') {
-        std::string rights = board.CastlingRights();
-        if (to == 56) {
-            RemoveCastlingRight(rights, 'q');
-        } else if (to == 63) {
-            RemoveCastlingRight(rights, 'k');
-        }
-        board.SetCastlingRights(rights);
-    }
+    // Any move from or to a king/rook home square clears the matching rights.
+    board.SetCastlingMask(prev_castling & CastlingRightsKept(from) & CastlingRightsKept(to));
 
     if ((moved == 'K' || moved == 'k') && (to - from == 2 || from - to == 2)) {
         was_castling = true;
@@ -358,6 +322,12 @@ MoveUndo ApplyMove(Board& board, const Move& move) {
         board.SetEnPassantSquare(from - 8);
     }
 
+    bool irreversible = moved == 'P' || moved == 'p' || captured != '.' || was_en_passant;
+    board.SetHalfmoveClock(irreversible ? 0 : prev_halfmove + 1);
+    if (side == 'b') {
+        board.SetFullmoveNumber(board.FullmoveNumber() + 1);
+    }
+
     return {from,
             to,
             moved,
@@ -371,7 +341,8 @@ MoveUndo ApplyMove(Board& board, const Move& move) {
             rook_to,
             rook_piece,
             was_castling,
-            prev_castling};
+            prev_castling,
+            prev_halfmove};
 }
 
 void UndoMoveApply(Board& board, const MoveUndo& undo) {
@@ -386,7 +357,31 @@ void UndoMoveApply(Board& board, const MoveUndo& undo) {
     }
     board.SetSideToMove(undo.side_to_move);
     board.SetEnPassantSquare(undo.prev_en_passant);
-    board.SetCastlingRights(undo.prev_castling_rights);
+    board.SetCastlingMask(undo.prev_castling_mask);
+    board.SetHalfmoveClock(undo.prev_halfmove_clock);
+    if (undo.side_to_move == 'b') {
+        board.SetFullmoveNumber(board.FullmoveNumber() - 1);
+    }
+    board.PopHistory();
+}
+
+NullMoveUndo ApplyNullMove(Board& board) {
+    NullMoveUndo undo{board.SideToMove(), board.EnPassantSquare(), board.HalfmoveClock(), board.RepetitionFloor()};
+    // Repetition scans never cross the null move; the fifty-move count goes on.
+    board.PushHistory();
+    board.SetRepetitionFloor(board.HistorySize());
+    board.SetHalfmoveClock(board.HalfmoveClock() + 1);
+    board.SetEnPassantSquare(-1);
+    board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    return undo;
+}
+
+void UndoNullMove(Board& board, const NullMoveUndo& undo) {
+    board.SetSideToMove(undo.side_to_move);
+    board.SetEnPassantSquare(undo.prev_en_passant);
+    board.SetHalfmoveClock(undo.prev_halfmove_clock);
+    board.SetRepetitionFloor(undo.prev_repetition_floor);
+    board.PopHistory();
 }
 
 bool IsSquareAttacked(const Board& board, int square, Color byColor) {
@@ -491,22 +486,22 @@ bool InCheck(const Board& board, Color color) {
     return IsSquareAttacked(board, king_square, Opposite(color));
 }
 
-void AddCastlingMoves(const Board& board, std::vector<Move>& moves, char side) {
+void AddCastlingMoves(const Board& board, MoveList& moves, char side) {
     Color color = ColorFromSide(side);
     if (InCheck(board, color)) {
         return;
     }
 
-    const std::string& rights = board.CastlingRights();
+    int rights = board.CastlingMask();
     if (side == 'w') {
-        if (rights.find('K') != std::string::npos) {
+        if (rights & kCastleWhiteKingside) {
             if (board.PieceAt(5) == '.' && board.PieceAt(6) == '.' &&
                 !IsSquareAttacked(board, 5, Color::Black) &&
                 !IsSquareAttacked(board, 6, Color::Black)) {
                 AddMove(moves, 4, 6);
             }
         }
-        if (rights.find('Q') != std::string::npos) {
+        if (rights & kCastleWhiteQueenside) {
             if (board.PieceAt(1) == '.' && board.PieceAt(2) == '.' && board.PieceAt(3) == '.' &&
                 !IsSquareAttacked(board, 3, Color::Black) &&
                 !IsSquareAttacked(board, 2, Color::Black)) {
@@ -514,14 +509,14 @@ void AddCastlingMoves(const Board& board, std::vector<Move>& moves, char side) {
             }
         }
     } else {
-        if (rights.find('k') != std::string::npos) {
+        if (rights & kCastleBlackKingside) {
             if (board.PieceAt(61) == '.' && board.PieceAt(62) == '.' &&
                 !IsSquareAttacked(board, 61, Color::White) &&
                 !IsSquareAttacked(board, 62, Color::White)) {
                 AddMove(moves, 60, 62);
             }
         }
-        if (rights.find('q') != std::string::npos) {
+        if (rights & kCastleBlackQueenside) {
             if (board.PieceAt(57) == '.' && board.PieceAt(58) == '.' && board.PieceAt(59) == '.' &&
                 !IsSquareAttacked(board, 59, Color::White) &&
                 !IsSquareAttacked(board, 58, Color::White)) {
@@ -531,8 +526,8 @@ void AddCastlingMoves(const Board& board, std::vector<Move>& moves, char side) {
     }
 }
 
-std::vector<Move> GeneratePseudoLegalMoves(const Board& board) {
-    std::vector<Move> moves;
+void GeneratePseudoLegalMoves(const Board& board, MoveList& moves) {
+    moves.clear();
     char side = board.SideToMove();
     for (int index = 0; index < 64; ++index) {
         char piece = board.PieceAt(index);
@@ -583,42 +578,63 @@ std::vector<Move> GeneratePseudoLegalMoves(const Board& board) {
                 break;
         }
     }
-    return moves;
 }
 
-std::vector<Move> GenerateLegalMoves(const Board& board) {
-    std::vector<Move> legal;
+void GenerateLegalMoves(Board& board, MoveList& out) {
+    MoveList pseudo;
+    GeneratePseudoLegalMoves(board, pseudo);
+    out.clear();
     Color side = ColorFromSide(board.SideToMove());
-    auto pseudo = GeneratePseudoLegalMoves(board);
-    Board scratch = board;
+    char enemy_king = side == Color::White ? 'k' : 'K';
     for (const auto& move : pseudo) {
-        char target = scratch.PieceAt(move.to());
-        if (target == (side == Color::White ? 'k' : 'K')) {
+        if (board.PieceAt(move.to()) == enemy_king) {
             continue;
         }
-        MoveUndo undo = ApplyMove(scratch, move);
-        if (!InCheck(scratch, side)) {
-            legal.push_back(move);
+        MoveUndo undo = ApplyMove(board, move);
+        if (!InCheck(board, side)) {
+            out.push_back(move);
         }
-        UndoMoveApply(scratch, undo);
+        UndoMoveApply(board, undo);
     }
-    return legal;
 }
 
-uint64_t Perft(const Board& board, int depth) {
+std::vector<Move> GeneratePseudoLegalMoves(const Board& board) {
+    MoveList moves;
+    GeneratePseudoLegalMoves(board, moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+std::vector<Move> GenerateLegalMoves(const Board& board) {
+    Board scratch = board;
+    MoveList moves;
+    GenerateLegalMoves(scratch, moves);
+    return std::vector<Move>(moves.begin(), moves.end());
+}
+
+namespace {
+uint64_t PerftInPlace(Board& board, int depth) {
     if (depth <= 0) {
         return 1;
     }
 
+    MoveList moves;
+    GenerateLegalMoves(board, moves);
+    if (depth == 1) {
+        return static_cast<uint64_t>(moves.size());
+    }
     uint64_t nodes = 0;
-    auto moves = GenerateLegalMoves(board);
-    Board scratch = board;
     for (const auto& move : moves) {
-        MoveUndo undo = ApplyMove(scratch, move);
-        char next_side = undo.side_to_move == 'w' ? 'b' : 'w';
-        scratch.SetSideToMove(next_side);
-        nodes += Perft(scratch, depth - 1);
-        UndoMoveApply(scratch, undo);
+        MoveUndo undo = ApplyMove(board, move);
+        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+        nodes += PerftInPlace(board, depth - 1);
+        UndoMoveApply(board, undo);
     }
     return nodes;
 }
+}  // namespace
+
+uint64_t Perft(const Board& board, int depth) {
+    Board scratch = board;
+    scratch.ReserveHistory(static_cast<size_t>(depth > 0 ? depth : 0));
+    return PerftInPlace(scratch, depth);
+}
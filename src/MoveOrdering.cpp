@@ -0,0 +1,55 @@
+#include "MoveOrdering.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+// Below the search's capture scores, above any history value.
+const int kKillerScore = 700000;
+const int kCounterMoveScore = 600000;
+
+int HistoryBonus(int depth) {
+    return std::min(depth * depth, kHistoryMax / 4);
+}
+}  // namespace
+
+int QuietMoveScore(const SearchHeuristics& heuristics,
+                   const KillerMoves& killers,
+                   const Move& previous,
+                   int side,
+                   const Move& move) {
+    if (move == killers[0]) {
+        return kKillerScore;
+    }
+    if (move == killers[1]) {
+        return kKillerScore - 1;
+    }
+    if (previous != Move() && move == heuristics.counter_moves[previous.from()][previous.to()]) {
+        return kCounterMoveScore;
+    }
+    return heuristics.history[side][move.from()][move.to()];
+}
+
+void UpdateHistory(int& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / kHistoryMax;
+}
+
+void RecordQuietCutoff(SearchHeuristics& heuristics,
+                       KillerMoves& killers,
+                       const Move& previous,
+                       int side,
+                       int depth,
+                       const Move& cutoff) {
+    if (killers[0] != cutoff) {
+        killers[1] = killers[0];
+        killers[0] = cutoff;
+    }
+    if (previous != Move()) {
+        heuristics.counter_moves[previous.from()][previous.to()] = cutoff;
+    }
+    UpdateHistory(heuristics.history[side][cutoff.from()][cutoff.to()], HistoryBonus(depth));
+}
+
+void PenalizeQuietMove(SearchHeuristics& heuristics, int side, int depth, const Move& move) {
+    UpdateHistory(heuristics.history[side][move.from()][move.to()], -HistoryBonus(depth));
+}
@@ -0,0 +1,120 @@
+#include "PerftSuite.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Board.h"
+#include "MoveGen.h"
+
+namespace {
+std::string Trim(const std::string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+// Parses the ";D<depth> <count>" fields that follow the FEN.
+bool ParseDepths(const std::string& fields, std::vector<std::pair<int, uint64_t>>& out) {
+    std::istringstream parts(fields);
+    std::string part;
+    while (std::getline(parts, part, ';')) {
+        part = Trim(part);
+        if (part.empty()) {
+            continue;
+        }
+        std::istringstream field(part);
+        std::string label;
+        uint64_t count = 0;
+        if (!(field >> label >> count) || label.size() < 2 || label[0] != 'D') {
+            return false;
+        }
+        int depth = std::atoi(label.c_str() + 1);
+        if (depth < 1) {
+            return false;
+        }
+        out.emplace_back(depth, count);
+    }
+    std::sort(out.begin(), out.end());
+    return !out.empty();
+}
+
+double Mnps(uint64_t nodes, std::chrono::steady_clock::duration elapsed) {
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return seconds > 0.0 ? static_cast<double>(nodes) / seconds / 1e6 : 0.0;
+}
+}  // namespace
+
+PerftSuiteResult RunPerftSuite(std::istream& epd, const PerftSuiteOptions& options, std::ostream& out) {
+    PerftSuiteResult result;
+    std::string line;
+    out << std::fixed << std::setprecision(2);
+    while (std::getline(epd, line)) {
+        line = Trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        size_t separator = line.find(';');
+        std::string fen = Trim(line.substr(0, separator));
+        std::vector<std::pair<int, uint64_t>> depths;
+        Board board;
+        if (separator == std::string::npos || !board.LoadFen(fen) || !ParseDepths(line.substr(separator), depths)) {
+            out << "invalid: " << line << '\n';
+            result.invalid += 1;
+            continue;
+        }
+
+        result.positions += 1;
+        out << "[" << result.positions << "] " << fen << '\n';
+        uint64_t position_nodes = 0;
+        std::chrono::steady_clock::duration position_time{0};
+        std::chrono::steady_clock::duration last_time{0};
+        uint64_t last_nodes = 0;
+        for (const auto& [depth, expected] : depths) {
+            bool over_depth = depth > options.maxDepth;
+            bool over_time = false;
+            if (options.timeCap.count() > 0 && last_nodes > 0) {
+                // Assume the next depth costs as much more as the node count grows.
+                double growth = static_cast<double>(expected) / static_cast<double>(last_nodes);
+                auto estimate = std::chrono::duration_cast<std::chrono::steady_clock::duration>(last_time * growth);
+                over_time = position_time + estimate > options.timeCap;
+            }
+            if (over_depth || over_time) {
+                out << "  depth " << depth << ": skipped (" << (over_depth ? "max depth" : "time cap") << ")\n";
+                result.skipped += 1;
+                continue;
+            }
+
+            auto start = std::chrono::steady_clock::now();
+            uint64_t nodes = Perft(board, depth);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            position_nodes += nodes;
+            position_time += elapsed;
+            last_time = elapsed;
+            last_nodes = nodes;
+            result.checked += 1;
+
+            out << "  depth " << depth << ": " << nodes;
+            if (nodes == expected) {
+                out << " ok";
+            } else {
+                out << " FAILED (expected " << expected << ")";
+                result.failed += 1;
+            }
+            out << " (" << std::chrono::duration<double>(elapsed).count() << " s)\n";
+        }
+        out << "  " << position_nodes << " nodes, " << Mnps(position_nodes, position_time) << " Mnps\n";
+    }
+    out << "Positions: " << result.positions << ", depths checked: " << result.checked
+        << ", failed: " << result.failed << ", skipped: " << result.skipped << ", invalid lines: " << result.invalid
+        << '\n';
+    return result;
+}
@@ -0,0 +1,238 @@
+#include "Pgn.h"
+
+#include <algorithm>
+#include <optional>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "San.h"
+
+namespace {
+const char* const kStartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const size_t kPgnLineWidth = 80;
+
+bool IsSpace(int c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool IsDigit(int c) {
+    return c >= '0' && c <= '9';
+}
+
+bool IsResult(const std::string& symbol) {
+    return symbol == "1-0" || symbol == "0-1" || symbol == "1/2-1/2" || symbol == "*";
+}
+
+// "12." and "12..." number the moves; they may also be glued to the move ("12.e4").
+std::string StripMoveNumber(const std::string& symbol) {
+    size_t digits = 0;
+    while (digits < symbol.size() && IsDigit(symbol[digits])) {
+        digits += 1;
+    }
+    if (digits == 0 || (digits < symbol.size() && symbol[digits] != '.')) {
+        return symbol;
+    }
+    size_t start = digits;
+    while (start < symbol.size() && symbol[start] == '.') {
+        start += 1;
+    }
+    return symbol.substr(start);
+}
+
+std::string EscapeTagValue(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+}  // namespace
+
+std::string PgnGame::Tag(const std::string& name) const {
+    for (const auto& [tag, value] : tags) {
+        if (tag == name) {
+            return value;
+        }
+    }
+    return "";
+}
+
+PgnReader::PgnReader(std::istream& in) : in_(in) {}
+
+int PgnReader::Peek() {
+    if (position_ == size_) {
+        in_.read(buffer_.data(), static_cast<std::streamsize>(buffer_.size()));
+        size_ = static_cast<size_t>(in_.gcount());
+        position_ = 0;
+        if (size_ == 0) {
+            return EOF;
+        }
+    }
+    return static_cast<unsigned char>(buffer_[position_]);
+}
+
+int PgnReader::Get() {
+    int c = Peek();
+    if (c != EOF) {
+        position_ += 1;
+    }
+    return c;
+}
+
+void PgnReader::SkipWhitespace() {
+    while (IsSpace(Peek())) {
+        Get();
+    }
+}
+
+bool PgnReader::ReadTag(PgnGame& game) {
+    Get();
+    SkipWhitespace();
+    std::string name;
+    while (Peek() != EOF && !IsSpace(Peek()) && Peek() != '"' && Peek() != ']') {
+        name += static_cast<char>(Get());
+    }
+    SkipWhitespace();
+    std::string value;
+    if (Peek() == '"') {
+        Get();
+        for (int c = Get(); c != EOF && c != '"'; c = Get()) {
+            if (c == '\\' && Peek() != EOF) {
+                c = Get();
+            }
+            value += static_cast<char>(c);
+        }
+    }
+    for (int c = Get(); c != EOF && c != ']' && c != '\n'; c = Get()) {
+    }
+    if (name.empty()) {
+        return false;
+    }
+    game.tags.emplace_back(name, value);
+    return true;
+}
+
+std::string PgnReader::ReadSymbol() {
+    std::string symbol;
+    for (int c = Peek(); c != EOF && !IsSpace(c); c = Peek()) {
+        if (c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ']' || c == ';' || c == '$' ||
+            c == '"') {
+            break;
+        }
+        symbol += static_cast<char>(Get());
+    }
+    return symbol;
+}
+
+void PgnReader::SetPlyLimit(size_t plies) {
+    ply_limit_ = plies;
+}
+
+bool PgnReader::Next(PgnGame& game) {
+    game = PgnGame{};
+    SkipWhitespace();
+    if (Peek() == EOF) {
+        return false;
+    }
+    while (Peek() == '[') {
+        ReadTag(game);
+        SkipWhitespace();
+    }
+
+    std::string fen = game.Tag("FEN");
+    game.startFen = fen.empty() ? kStartFen : fen;
+    Board board;
+    if (!board.LoadFen(game.startFen)) {
+        game.error = "invalid FEN tag";
+    }
+
+    int variation_depth = 0;
+    while (true) {
+        SkipWhitespace();
+        int c = Peek();
+        if (c == EOF || (c == '[' && variation_depth == 0)) {
+            // End of input, or the next game's tags after a game without a result.
+            break;
+        }
+        if (c == '{') {
+            while ((c = Get()) != EOF && c != '}') {
+            }
+            continue;
+        }
+        if (c == ';') {
+            while ((c = Get()) != EOF && c != '\n') {
+            }
+            continue;
+        }
+        if (c == '(' || c == ')') {
+            Get();
+            variation_depth = c == '(' ? variation_depth + 1 : std::max(variation_depth - 1, 0);
+            continue;
+        }
+        if (c == '$') {
+            Get();
+            while (IsDigit(Peek())) {
+                Get();
+            }
+            continue;
+        }
+        std::string symbol = ReadSymbol();
+        if (symbol.empty()) {
+            Get();
+            continue;
+        }
+        if (variation_depth > 0) {
+            continue;
+        }
+        if (IsResult(symbol)) {
+            game.result = symbol;
+            break;
+        }
+        std::string san = StripMoveNumber(symbol);
+        if (san.empty() || !game.error.empty() || game.moves.size() >= ply_limit_) {
+            continue;
+        }
+        std::optional<Move> move = ParseSan(board, san);
+        if (!move) {
+            game.error = "illegal or ambiguous move " + san + " at ply " + std::to_string(game.moves.size() + 1);
+            continue;
+        }
+        game.moves.push_back(*move);
+        MoveUndo undo = ApplyMove(board, *move);
+        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    }
+    return true;
+}
+
+void WritePgn(const PgnGame& game, std::ostream& out) {
+    for (const auto& [name, value] : game.tags) {
+        out << '[' << name << " \"" << EscapeTagValue(value) << "\"]\n";
+    }
+    out << '\n';
+
+    std::string line;
+    auto emit = [&](const std::string& token) {
+        if (!line.empty() && line.size() + 1 + token.size() > kPgnLineWidth) {
+            out << line << '\n';
+            line.clear();
+        }
+        line += line.empty() ? token : " " + token;
+    };
+    Board board;
+    board.LoadFen(game.startFen.empty() ? kStartFen : game.startFen);
+    for (size_t i = 0; i < game.moves.size(); ++i) {
+        if (board.SideToMove() == 'w') {
+            emit(std::to_string(board.FullmoveNumber()) + ".");
+        } else if (i == 0) {
+            emit(std::to_string(board.FullmoveNumber()) + "...");
+        }
+        emit(MoveToSan(board, game.moves[i]));
+        MoveUndo undo = ApplyMove(board, game.moves[i]);
+        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    }
+    emit(game.result.empty() ? "*" : game.result);
+    out << line << "\n\n";
+}
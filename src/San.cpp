@@ -0,0 +1,170 @@
+#include "San.h"
+
+#include <cctype>
+
+#include "MoveGen.h"
+
+namespace {
+char PieceType(const Board& board, int square) {
+    return static_cast<char>(std::toupper(static_cast<unsigned char>(board.PieceAt(square))));
+}
+
+bool IsCastling(const Board& board, const Move& move) {
+    int distance = move.to() - move.from();
+    return PieceType(board, move.from()) == 'K' && (distance == 2 || distance == -2);
+}
+
+bool IsCapture(const Board& board, const Move& move) {
+    if (board.PieceAt(move.to()) != '.') {
+        return true;
+    }
+    return PieceType(board, move.from()) == 'P' && move.to() == board.EnPassantSquare();
+}
+
+// Make/unmake legality test for a pseudo-legal move; the board is unchanged on return.
+bool IsLegal(Board& board, const Move& move) {
+    Color side = board.SideToMove() == 'w' ? Color::White : Color::Black;
+    MoveUndo undo = ApplyMove(board, move);
+    bool legal = !InCheck(board, side);
+    UndoMoveApply(board, undo);
+    return legal;
+}
+}  // namespace
+
+std::optional<Move> ParseSan(Board& board, const std::string& san) {
+    std::string text = san;
+    while (!text.empty() && (text.back() == '+' || text.back() == '#' || text.back() == '!' || text.back() == '?')) {
+        text.pop_back();
+    }
+    // Candidates are filtered on the pseudo-legal list; only matches pay for a legality test.
+    MoveList pseudo;
+    GeneratePseudoLegalMoves(board, pseudo);
+
+    if (text == "O-O" || text == "0-0" || text == "O-O-O" || text == "0-0-0") {
+        bool kingside = text.size() == 3;
+        for (const Move& move : pseudo) {
+            if (IsCastling(board, move) && (move.to() > move.from()) == kingside && IsLegal(board, move)) {
+                return move;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Promotion: "=Q" or a bare trailing piece letter.
+    std::optional<char> promotion;
+    if (text.size() >= 2 && std::string("QRBN").find(text.back()) != std::string::npos) {
+        promotion = static_cast<char>(std::tolower(static_cast<unsigned char>(text.back())));
+        text.pop_back();
+        if (!text.empty() && text.back() == '=') {
+            text.pop_back();
+        }
+    }
+    if (text.size() < 2) {
+        return std::nullopt;
+    }
+    auto to = SquareFromString(text.substr(text.size() - 2));
+    if (!to) {
+        return std::nullopt;
+    }
+    text.resize(text.size() - 2);
+
+    char piece = 'P';
+    size_t pos = 0;
+    if (!text.empty() && std::string("NBRQK").find(text[0]) != std::string::npos) {
+        piece = text[0];
+        pos = 1;
+    }
+    // Whatever is left is disambiguation and an optional capture mark.
+    int from_file = -1;
+    int from_rank = -1;
+    for (; pos < text.size(); ++pos) {
+        char c = text[pos];
+        if (c >= 'a' && c <= 'h') {
+            from_file = c - 'a';
+        } else if (c >= '1' && c <= '8') {
+            from_rank = c - '1';
+        } else if (c != 'x' && c != ':' && c != '-') {
+            return std::nullopt;
+        }
+    }
+
+    std::optional<Move> found;
+    for (const Move& move : pseudo) {
+        if (move.to() != *to || PieceType(board, move.from()) != piece || move.promotion() != promotion ||
+            IsCastling(board, move)) {
+            continue;
+        }
+        if ((from_file >= 0 && move.from() % 8 != from_file) || (from_rank >= 0 && move.from() / 8 != from_rank)) {
+            continue;
+        }
+        if (!IsLegal(board, move)) {
+            continue;
+        }
+        if (found) {
+            return std::nullopt;
+        }
+        found = move;
+    }
+    return found;
+}
+
+std::string MoveToSan(Board& board, const Move& move) {
+    std::string san;
+    char piece = PieceType(board, move.from());
+    std::string to_text = SquareToString(move.to()).value_or("??");
+    if (IsCastling(board, move)) {
+        san = move.to() > move.from() ? "O-O" : "O-O-O";
+    } else if (piece == 'P') {
+        if (IsCapture(board, move)) {
+            san += static_cast<char>('a' + move.from() % 8);
+            san += 'x';
+        }
+        san += to_text;
+        if (move.promotion()) {
+            san += '=';
+            san += static_cast<char>(std::toupper(static_cast<unsigned char>(*move.promotion())));
+        }
+    } else {
+        san += piece;
+        // Other pieces of the same type that can reach the square decide the disambiguation.
+        bool ambiguous = false;
+        bool same_file = false;
+        bool same_rank = false;
+        MoveList pseudo;
+        GeneratePseudoLegalMoves(board, pseudo);
+        for (const Move& other : pseudo) {
+            if (other.to() != move.to() || other.from() == move.from() || PieceType(board, other.from()) != piece ||
+                !IsLegal(board, other)) {
+                continue;
+            }
+            ambiguous = true;
+            same_file = same_file || other.from() % 8 == move.from() % 8;
+            same_rank = same_rank || other.from() / 8 == move.from() / 8;
+        }
+        if (ambiguous) {
+            std::string from_text = SquareToString(move.from()).value_or("??");
+            if (!same_file) {
+                san += from_text[0];
+            } else if (!same_rank) {
+                san += from_text[1];
+            } else {
+                san += from_text;
+            }
+        }
+        if (IsCapture(board, move)) {
+            san += 'x';
+        }
+        san += to_text;
+    }
+
+    MoveUndo undo = ApplyMove(board, move);
+    board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    Color opponent = board.SideToMove() == 'w' ? Color::White : Color::Black;
+    if (InCheck(board, opponent)) {
+        MoveList replies;
+        GenerateLegalMoves(board, replies);
+        san += replies.empty() ? '#' : '+';
+    }
+    UndoMoveApply(board, undo);
+    return san;
+}
@@ -1,37 +1,203 @@
 #include "Search.h"
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include "MoveGen.h"
+#include "MoveOrdering.h"
+#include "Tablebase.h"
+#include "TimeManager.h"
 #include "TranspositionTable.h"
 
 namespace {
 const int kCheckmateScore = 100000;
 const int kTimeOutScore = 200000;
 const int kMateThreshold = 99000;
+const int kInfinity = 1000000;
+const int kAspirationWindow = 50;
+const int kAspirationMinDepth = 3;
+// A root score this far below the previous iteration's counts as a fail-low for timing.
+const int kScoreDropMargin = 30;
+const int kNullMoveMinDepth = 3;
+const int kLmrMinDepth = 3;
+const int kLmrMinMoveIndex = 3;
+const int kLmrTableSize = 64;
+const int kMaxPly = 128;
+// Tablebase wins score below every mate and above every evaluation; like mates they are
+// shortened by the ply so that the quickest way into a won ending is preferred. Scores
+// beyond kTablebaseThreshold are such distance-relative wins (or mates): the TT stores
+// them relative to the node, and null-move and aspiration windows do not trust them.
+const int kTablebaseWinScore = kMateThreshold - kMaxPly - 1;
+const int kTablebaseThreshold = kTablebaseWinScore - kMaxPly;
+// Root moves in a tablebase position rank by their distance below this, certain wins above
+// half of it.
+const int kMaxDtzRank = 1 << 18;
+// Nodes between polls of the clock and the stop flag.
+const int kStopCheckInterval = 1024;
 
-TranspositionTable g_tt(1 << 20);
+const int kTTMoveScore = 1000000;
+const int kPromotionScore = 900000;
+const int kCaptureScore = 800000;
+
+// Late move reduction in plies, indexed by [depth][moveIndex]; grows with
+// log(depth) * log(moveIndex) so deep nodes and late moves are reduced the most.
+using LmrTable = std::array<std::array<int, kLmrTableSize>, kLmrTableSize>;
+
+LmrTable BuildLmrTable() {
+    LmrTable table{};
+    for (int depth = 1; depth < kLmrTableSize; ++depth) {
+        for (int index = 1; index < kLmrTableSize; ++index) {
+            table[depth][index] = static_cast<int>(0.75 + std::log(depth) * std::log(index) / 2.25);
+        }
+    }
+    return table;
+}
+
+const LmrTable kLmrTable = BuildLmrTable();
+
+// Everything a search needs at one ply, preallocated so Negamax and Quiescence never touch
+// the heap: the move list with its ordering scores, the undo records, the killer slots, the
+// static evaluation and the move currently being searched (Move() for a null move).
+// pv is this ply's row of the triangular PV table: the best line found from here, built
+// from the move that raised alpha and the row of the ply below. on_pv is set while the
+// path from the root still follows the previous iteration's principal variation.
+struct SearchFrame {
+    MoveList moves;
+    std::array<int, kMaxMoves> scores;
+    MoveUndo undo;
+    NullMoveUndo null_undo;
+    KillerMoves killers;
+    int static_eval;
+    Move current_move;
+    MoveList pv;
+    bool on_pv;
+};
+
+using SearchStack = std::array<SearchFrame, kMaxPly + 1>;
+
+// A root move with what the last iterations learned about it. score is exact or a lower
+// bound when the move raised alpha (always for the first move searched) and -kInfinity when
+// it only proved to be no better than alpha; nodes is the effort spent on it.
+struct RootMove {
+    Move move;
+    int score;
+    int previous_score;
+    uint64_t nodes;
+};
+
+// Root moves persist for the whole iterative deepening loop and are re-sorted after every
+// pass instead of being regenerated.
+struct RootMoveList {
+    std::array<RootMove, kMaxMoves> moves;
+    int count;
+};
+
+// State for a single search invocation; the tables it references belong to a SearchContext.
+struct SearchState {
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point soft_deadline;
+    uint64_t max_nodes;
+    const std::atomic<bool>& stop_requested;
+    const std::atomic<bool>& pondering;
+    bool ponder_active;
+    uint64_t nodes;
+    uint64_t qnodes;
+    TranspositionTable& tt;
+    SearchHeuristics& heuristics;
+    SearchStack& stack;
+    RootMoveList& root_moves;
+    const MoveList& previous_pv;
+    int seldepth;
+    int stop_check_countdown;
+    bool stopped;
+    // Pieces on the board at the root; a ply removes at most one.
+    int root_pieces = 0;
+    uint64_t tb_hits = 0;
+#ifdef CHESSENGINE_SEARCH_STATS
+    SearchInstrumentation* instrumentation = nullptr;
+    // Ply at which the current quiescence search started.
+    int qsearch_entry_ply = 0;
+#endif
+};
 
 bool TimeUp(std::chrono::steady_clock::time_point deadline) {
     return std::chrono::steady_clock::now() >= deadline;
 }
 
+// While pondering the deadlines do not apply. When the context leaves pondering, the time
+// budget restarts: start and both deadlines move forward by the time spent pondering.
+bool DeadlinePassed(SearchState& state) {
+    if (state.ponder_active) {
+        if (state.pondering.load(std::memory_order_acquire)) {
+            return false;
+        }
+        state.ponder_active = false;
+        auto shift = std::chrono::steady_clock::now() - state.start;
+        state.start += shift;
+        if (state.deadline != std::chrono::steady_clock::time_point::max()) {
+            state.deadline += shift;
+        }
+        if (state.soft_deadline != std::chrono::steady_clock::time_point::max()) {
+            state.soft_deadline += shift;
+        }
+    }
+    return TimeUp(state.deadline);
+}
+
+// Called at every node. The node limit is exact: it is checked here before each node is
+// counted, so a node-limited search stops after exactly max_nodes nodes and is
+// deterministic. Reading the clock is comparatively expensive, so the deadline and the stop
+// flag are only polled every kStopCheckInterval nodes. Once stopped, the search stays
+// stopped and unwinds with kTimeOutScore.
+bool ShouldStop(SearchState& state) {
+    if (state.stopped) {
+        return true;
+    }
+    if (state.max_nodes > 0 && state.nodes + state.qnodes >= state.max_nodes) {
+        state.stopped = true;
+        return true;
+    }
+    if (--state.stop_check_countdown > 0) {
+        return false;
+    }
+    state.stop_check_countdown = kStopCheckInterval;
+    state.stopped = state.stop_requested.load(std::memory_order_relaxed) || DeadlinePassed(state);
+    return state.stopped;
+}
+
+// Makes the PV at ply the move just searched followed by the line below it.
+void UpdatePv(SearchStack& stack, int ply, const Move& move) {
+    MoveList& pv = stack[ply].pv;
+    const MoveList& child = stack[ply + 1].pv;
+    pv.clear();
+    pv.push_back(move);
+    for (const Move& next : child) {
+        pv.push_back(next);
+    }
+}
+
 int ToTTScore(int score, int ply) {
-    if (score > kMateThreshold) {
+    if (score >= kTablebaseThreshold) {
         return score + ply;
     }
-    if (score < -kMateThreshold) {
+    if (score <= -kTablebaseThreshold) {
         return score - ply;
     }
     return score;
 }
 
 int FromTTScore(int score, int ply) {
-    if (score > kMateThreshold) {
+    if (score >= kTablebaseThreshold) {
         return score - ply;
     }
-    if (score < -kMateThreshold) {
+    if (score <= -kTablebaseThreshold) {
         return score + ply;
     }
     return score;
@@ -212,73 +378,164 @@ int CaptureValue(const Board& board, const Move& move) {
     return PieceValue(target);
 }
 
-int MoveScore(const Board& board, const Move& move, const Move* preferred) {
-    if (preferred != nullptr && move.ToUci() == preferred->ToUci()) {
-        return 100000;
+int SideIndex(char side) {
+    return side == 'w' ? 0 : 1;
+}
+
+// Evaluation and move generation as the search calls them, timed when instrumentation is on.
+int EvaluateNode(const Board& board, [[maybe_unused]] SearchState& state) {
+    SEARCH_STAT(ScopedStatTimer timer(state.instrumentation->eval_time);)
+    return Evaluate(board);
+}
+
+void GenerateNodeMoves(Board& board, MoveList& moves, [[maybe_unused]] SearchState& state) {
+    SEARCH_STAT(ScopedStatTimer timer(state.instrumentation->movegen_time);)
+    GenerateLegalMoves(board, moves);
+}
+
+int MoveScore(const Board& board, const Move& move, const Move* preferred, const SearchState* state, int ply) {
+    if (preferred != nullptr && move == *preferred) {
+        return kTTMoveScore;
     }
     if (move.promotion().has_value()) {
-        return 3000 + PieceValue(move.promotion().value());
+        return kPromotionScore + PieceValue(move.promotion().value());
     }
     if (IsCaptureMove(board, move)) {
         int captured = CaptureValue(board, move);
         int attacker = PieceValue(board.PieceAt(move.from()));
-        return 2000 + (captured * 10 - attacker);
+        return kCaptureScore + (captured * 10 - attacker);
+    }
+    if (state == nullptr) {
+        return 0;
+    }
+    const Move& previous = ply > 0 ? state->stack[ply - 1].current_move : Move();
+    return QuietMoveScore(state->heuristics, state->stack[ply].killers, previous, SideIndex(board.SideToMove()), move);
+}
+
+// Scores by TT move, promotions, MVV-LVA captures, then (when a search state is given)
+// killers, counter move and history for quiet moves.
+void ScoreMoves(const Board& board, SearchFrame& frame, const Move* preferred, const SearchState* state, int ply) {
+    for (int i = 0; i < frame.moves.size(); ++i) {
+        frame.scores[i] = MoveScore(board, frame.moves[i], preferred, state, ply);
+    }
+}
+
+// Selection step: swaps the best remaining move into `index`. Cutoffs usually come early, so
+// picking lazily is cheaper than sorting the whole list up front.
+const Move& PickMove(SearchFrame& frame, int index) {
+    int best = index;
+    for (int i = index + 1; i < frame.moves.size(); ++i) {
+        if (frame.scores[i] > frame.scores[best]) {
+            best = i;
+        }
+    }
+    if (best != index) {
+        std::swap(frame.moves[index], frame.moves[best]);
+        std::swap(frame.scores[index], frame.scores[best]);
+    }
+    return frame.moves[index];
+}
+
+// Stable full sort used at the root, where every move is searched anyway.
+void SortMoves(SearchFrame& frame) {
+    for (int i = 1; i < frame.moves.size(); ++i) {
+        Move move = frame.moves[i];
+        int score = frame.scores[i];
+        int j = i - 1;
+        while (j >= 0 && frame.scores[j] < score) {
+            frame.moves[j + 1] = frame.moves[j];
+            frame.scores[j + 1] = frame.scores[j];
+            --j;
+        }
+        frame.moves[j + 1] = move;
+        frame.scores[j + 1] = score;
     }
-    return 0;
 }
 
-void OrderMoves(const Board& board, std::vector<Move>& moves, const Move* preferred) {
-    std::stable_sort(moves.begin(), moves.end(), [&](const Move& a, const Move& b) {
-        return MoveScore(board, a, preferred) > MoveScore(board, b, preferred);
-    });
+bool IsQuietMove(const Board& board, const Move& move) {
+    return !move.promotion().has_value() && !IsCaptureMove(board, move);
 }
 
-int Quiescence(Board& board,
-               int alpha,
-               int beta,
-               int ply,
-               std::chrono::steady_clock::time_point deadline,
-               uint64_t& qnodes) {
-    if (TimeUp(deadline)) {
+// Rewards the quiet move that caused a beta cutoff and penalises the quiet moves tried
+// before it (the frame's moves ahead of `cutoffIndex`).
+void UpdateQuietHeuristics(SearchState& state, const Board& board, int ply, int depth, int cutoffIndex) {
+    SearchFrame& frame = state.stack[ply];
+    const Move& previous = ply > 0 ? state.stack[ply - 1].current_move : Move();
+    int side = SideIndex(board.SideToMove());
+    RecordQuietCutoff(state.heuristics, frame.killers, previous, side, depth, frame.moves[cutoffIndex]);
+    for (int i = 0; i < cutoffIndex; ++i) {
+        const Move& tried = frame.moves[i];
+        if (IsQuietMove(board, tried)) {
+            PenalizeQuietMove(state.heuristics, side, depth, tried);
+        }
+    }
+}
+
+// Null-move pruning is unsound in zugzwang, which is mostly a king-and-pawn phenomenon, so it
+// is only tried when the side to move still has a knight, bishop, rook or queen.
+bool HasNonPawnMaterial(const Board& board, char side) {
+    for (int i = 0; i < 64; ++i) {
+        char piece = board.PieceAt(i);
+        if (side == 'w' && (piece == 'N' || piece == 'B' || piece == 'R' || piece == 'Q')) {
+            return true;
+        }
+        if (side == 'b' && (piece == 'n' || piece == 'b' || piece == 'r' || piece == 'q')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int Quiescence(Board& board, int alpha, int beta, int ply, SearchState& state) {
+    if (ShouldStop(state)) {
         return kTimeOutScore;
     }
+    state.stack[ply].pv.clear();
+    state.seldepth = std::max(state.seldepth, ply);
 
     int alpha_orig = alpha;
     uint64_t key = board.Hash();
-    Move tt_move(0, 0);
+    Move tt_move;
     int tt_score = 0;
-    if (g_tt.Probe(key, 0, ToTTScore(alpha, ply), ToTTScore(beta, ply), tt_score, tt_move)) {
+    if (state.tt.Probe(key, 0, ToTTScore(alpha, ply), ToTTScore(beta, ply), tt_score, tt_move)) {
         return FromTTScore(tt_score, ply);
     }
 
-    qnodes += 1;
-    int stand_pat = Evaluate(board);
+    state.qnodes += 1;
+    SEARCH_STAT(state.instrumentation->qsearch_depth[std::min(ply - state.qsearch_entry_ply, kStatsQsearchDepths - 1)] +=
+                1;)
+    SearchFrame& frame = state.stack[ply];
+    int stand_pat = EvaluateNode(board, state);
+    frame.static_eval = stand_pat;
     if (stand_pat >= beta) {
         return beta;
     }
     if (stand_pat > alpha) {
         alpha = stand_pat;
     }
+    if (ply >= kMaxPly) {
+        return alpha;
+    }
 
-    auto moves = GenerateLegalMoves(board);
-    Move hint(0, 0);
-    const Move* hint_ptr = g_tt.PeekBestMove(key, hint) ? &hint : nullptr;
-    OrderMoves(board, moves, hint_ptr);
-    Move best_move(0, 0);
-    for (const auto& move : moves) {
+    GenerateNodeMoves(board, frame.moves, state);
+    const Move* hint_ptr = state.tt.PeekBestMove(key, tt_move) ? &tt_move : nullptr;
+    ScoreMoves(board, frame, hint_ptr, nullptr, ply);
+    Move best_move;
+    for (int i = 0; i < frame.moves.size(); ++i) {
+        const Move& move = PickMove(frame, i);
         if (!IsCaptureMove(board, move)) {
             continue;
         }
-        MoveUndo undo = ApplyMove(board, move);
-        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
-        int score = -Quiescence(board, -beta, -alpha, ply + 1, deadline, qnodes);
-        UndoMoveApply(board, undo);
+        frame.undo = ApplyMove(board, move);
+        board.SetSideToMove(frame.undo.side_to_move == 'w' ? 'b' : 'w');
+        int score = -Quiescence(board, -beta, -alpha, ply + 1, state);
+        UndoMoveApply(board, frame.undo);
 
         if (score == -kTimeOutScore) {
             return kTimeOutScore;
         }
         if (score >= beta) {
-            g_tt.Store(key, 0, ToTTScore(score, ply), Bound::LOWER, &move);
+            state.tt.Store(key, 0, ToTTScore(score, ply), Bound::LOWER, &move);
             return beta;
         }
         if (score > alpha) {
@@ -289,9 +546,9 @@ int Quiescence(Board& board,
 
     Bound bound = (alpha <= alpha_orig) ? Bound::UPPER : Bound::EXACT;
     if (best_move.from() != best_move.to()) {
-        g_tt.Store(key, 0, ToTTScore(alpha, ply), bound, &best_move);
+        state.tt.Store(key, 0, ToTTScore(alpha, ply), bound, &best_move);
     } else {
-        g_tt.Store(key, 0, ToTTScore(alpha, ply), bound, nullptr);
+        state.tt.Store(key, 0, ToTTScore(alpha, ply), bound, nullptr);
     }
 
     return alpha;
@@ -302,42 +559,125 @@ int Negamax(Board& board,
             int ply,
             int alpha,
             int beta,
-            std::chrono::steady_clock::time_point deadline,
-            uint64_t& nodes,
-            uint64_t& qnodes) {
-    if (TimeUp(deadline)) {
+            SearchState& state,
+            bool allowNull) {
+    if (ShouldStop(state)) {
         return kTimeOutScore;
     }
+    SearchFrame& frame = state.stack[ply];
+    const SearchFrame& parent = state.stack[ply - 1];
+    frame.pv.clear();
+    frame.on_pv = parent.on_pv && ply - 1 < state.previous_pv.size() && parent.current_move == state.previous_pv[ply - 1];
+    state.seldepth = std::max(state.seldepth, ply);
+    // Negamax is never called for the root, so any repetition on the path is a draw.
+    if (board.IsRepetition()) {
+        return 0;
+    }
+    // The fifty-move rule draws, unless the move that reached it mated.
+    if (board.IsFiftyMoveDraw()) {
+        if (InCheck(board, board.SideToMove() == 'w' ? Color::White : Color::Black)) {
+            GenerateNodeMoves(board, frame.moves, state);
+            if (frame.moves.empty()) {
+                return -kCheckmateScore + ply;
+            }
+        }
+        return 0;
+    }
+    // Right after a capture or pawn move into an ending the tablebase knows, the result is
+    // exact.
+    if (state.root_pieces - ply <= kTablebaseMaxPieces && board.HalfmoveClock() == 0) {
+        Wdl wdl;
+        if (ProbeWdl(board, wdl)) {
+            state.tb_hits += 1;
+            return wdl == Wdl::Win ? kTablebaseWinScore - ply : wdl == Wdl::Loss ? -kTablebaseWinScore + ply : 0;
+        }
+    }
     if (depth == 0) {
-        nodes += 1;
-        return Quiescence(board, alpha, beta, ply, deadline, qnodes);
+        state.nodes += 1;
+        SEARCH_STAT(state.qsearch_entry_ply = ply;)
+        return Quiescence(board, alpha, beta, ply, state);
+    }
+    if (ply >= kMaxPly) {
+        return EvaluateNode(board, state);
     }
 
     int alpha_orig = alpha;
     uint64_t key = board.Hash();
-    Move tt_move(0, 0);
+    Move tt_move;
     int tt_score = 0;
-    if (g_tt.Probe(key, depth, ToTTScore(alpha, ply), ToTTScore(beta, ply), tt_score, tt_move)) {
+    // No cutoffs in PV nodes (open window): they are few, and searching them keeps the
+    // principal variation complete.
+    bool pv_node = beta - alpha > 1;
+    if (!pv_node && state.tt.Probe(key, depth, ToTTScore(alpha, ply), ToTTScore(beta, ply), tt_score, tt_move)) {
         return FromTTScore(tt_score, ply);
     }
 
-    auto moves = GenerateLegalMoves(board);
-    const Move* tt_ptr = g_tt.PeekBestMove(key, tt_move) ? &tt_move : nullptr;
-    OrderMoves(board, moves, tt_ptr);
-    if (moves.empty()) {
-        if (InCheck(board, board.SideToMove() == 'w' ? Color::White : Color::Black)) {
+    bool in_check = InCheck(board, board.SideToMove() == 'w' ? Color::White : Color::Black);
+    frame.static_eval = in_check ? -kInfinity : EvaluateNode(board, state);
+    if (allowNull && !in_check && depth >= kNullMoveMinDepth && beta < kTablebaseThreshold &&
+        HasNonPawnMaterial(board, board.SideToMove()) && frame.static_eval >= beta) {
+        int reduction = 2 + depth / 4;
+        frame.null_undo = ApplyNullMove(board);
+        frame.current_move = Move();
+        int null_score = -Negamax(board, std::max(depth - 1 - reduction, 0), ply + 1, -beta, -beta + 1, state, false);
+        UndoNullMove(board, frame.null_undo);
+        if (null_score == -kTimeOutScore) {
+            return kTimeOutScore;
+        }
+        if (null_score >= beta) {
+            // Do not trust mate or tablebase scores proven after passing the turn.
+            return null_score >= kTablebaseThreshold ? beta : null_score;
+        }
+    }
+
+    GenerateNodeMoves(board, frame.moves, state);
+    if (frame.moves.empty()) {
+        if (in_check) {
             return -kCheckmateScore + ply;
         }
         return 0;
     }
+    // Along the previous principal variation its move comes first, even if the TT entry
+    // holding it has been overwritten.
+    const Move* hint_ptr = state.tt.PeekBestMove(key, tt_move) ? &tt_move : nullptr;
+    if (frame.on_pv && ply < state.previous_pv.size()) {
+        hint_ptr = &state.previous_pv[ply];
+    }
+    ScoreMoves(board, frame, hint_ptr, &state, ply);
 
     int best = std::numeric_limits<int>::min();
-    Move best_move(0, 0);
-    for (const auto& move : moves) {
-        MoveUndo undo = ApplyMove(board, move);
-        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
-        int score = -Negamax(board, depth - 1, ply + 1, -beta, -alpha, deadline, nodes, qnodes);
-        UndoMoveApply(board, undo);
+    Move best_move;
+    for (int move_index = 0; move_index < frame.moves.size(); ++move_index) {
+        const Move& move = PickMove(frame, move_index);
+        bool quiet = IsQuietMove(board, move);
+        frame.current_move = move;
+        frame.undo = ApplyMove(board, move);
+        board.SetSideToMove(frame.undo.side_to_move == 'w' ? 'b' : 'w');
+        int score = 0;
+        if (move_index == 0) {
+            score = -Negamax(board, depth - 1, ply + 1, -beta, -alpha, state, true);
+        } else {
+            // Late quiet moves are unlikely to be best under good ordering: search them at
+            // reduced depth first and fall back to the full depth only if they beat alpha.
+            int reduction = 0;
+            if (quiet && !in_check && depth >= kLmrMinDepth && move_index >= kLmrMinMoveIndex &&
+                !InCheck(board, board.SideToMove() == 'w' ? Color::White : Color::Black)) {
+                reduction = kLmrTable[std::min(depth, kLmrTableSize - 1)][std::min(move_index, kLmrTableSize - 1)];
+                reduction = std::min(reduction, depth - 2);
+            }
+            if (reduction > 0) {
+                score = -Negamax(board, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha, state, true);
+            }
+            // Principal variation search: later moves only need to prove they are no better
+            // than alpha, so try a null window first and re-search on a fail high.
+            if (reduction == 0 || (score != -kTimeOutScore && score > alpha)) {
+                score = -Negamax(board, depth - 1, ply + 1, -alpha - 1, -alpha, state, true);
+            }
+            if (score != -kTimeOutScore && score > alpha && score < beta) {
+                score = -Negamax(board, depth - 1, ply + 1, -beta, -alpha, state, true);
+            }
+        }
+        UndoMoveApply(board, frame.undo);
 
         if (score == -kTimeOutScore) {
             return kTimeOutScore;
@@ -348,9 +688,15 @@ int Negamax(Board& board,
         }
         if (score > alpha) {
             alpha = score;
+            UpdatePv(state.stack, ply, move);
         }
         if (alpha >= beta) {
-            g_tt.Store(key, depth, ToTTScore(score, ply), Bound::LOWER, &move);
+            SEARCH_STAT(state.instrumentation->cutoffs += 1;
+                        state.instrumentation->first_move_cutoffs += move_index == 0 ? 1 : 0;)
+            state.tt.Store(key, depth, ToTTScore(score, ply), Bound::LOWER, &move);
+            if (quiet) {
+                UpdateQuietHeuristics(state, board, ply, depth, move_index);
+            }
             break;
         }
     }
@@ -359,119 +705,517 @@ int Negamax(Board& board,
         Bound bound = (best <= alpha_orig) ? Bound::UPPER : (best >= beta ? Bound::LOWER : Bound::EXACT);
         if (best != kTimeOutScore) {
             if (best_move.from() != best_move.to()) {
-                g_tt.Store(key, depth, ToTTScore(best, ply), bound, &best_move);
+                state.tt.Store(key, depth, ToTTScore(best, ply), bound, &best_move);
             } else {
-                g_tt.Store(key, depth, ToTTScore(best, ply), bound, nullptr);
+                state.tt.Store(key, depth, ToTTScore(best, ply), bound, nullptr);
             }
         }
     }
 
     return best;
 }
-}  // namespace
 
-int EvaluateMaterial(const Board& board) {
-    return Evaluate(board);
-}
-
-int SearchBestMove(Board& board, int depth, Move& outBestMove) {
-    auto moves = GenerateLegalMoves(board);
-    OrderMoves(board, moves, nullptr);
-    if (moves.empty() || depth <= 0) {
-        return 0;
+// Searches the root moves from index first on, in the order of state.root_moves, once with
+// principal variation search and records each move's score and node count. Moves before
+// first are the lines a MultiPV search already found and are excluded. Returns the best
+// score (fail-soft with respect to [alpha, beta]) or kTimeOutScore if the deadline was hit;
+// outBestMove is only replaced by moves whose search completed.
+int SearchRoot(Board& board, int depth, int alpha, int beta, SearchState& state, int first, Move& outBestMove) {
+    SearchFrame& frame = state.stack[0];
+    RootMoveList& root = state.root_moves;
+    for (int i = first; i < root.count; ++i) {
+        root.moves[i].score = -kInfinity;
     }
+    frame.on_pv = true;
+    int best = std::numeric_limits<int>::min();
+    for (int i = first; i < root.count; ++i) {
+        RootMove& root_move = root.moves[i];
+        const Move& move = root_move.move;
+        uint64_t nodes_before = state.nodes + state.qnodes;
+        frame.current_move = move;
+        frame.undo = ApplyMove(board, move);
+        board.SetSideToMove(frame.undo.side_to_move == 'w' ? 'b' : 'w');
+        int score = 0;
+        if (i == first) {
+            score = -Negamax(board, depth - 1, 1, -beta, -alpha, state, true);
+        } else {
+            score = -Negamax(board, depth - 1, 1, -alpha - 1, -alpha, state, true);
+            if (score != -kTimeOutScore && score > alpha && score < beta) {
+                score = -Negamax(board, depth - 1, 1, -beta, -alpha, state, true);
+            }
+        }
+        UndoMoveApply(board, frame.undo);
+        root_move.nodes = state.nodes + state.qnodes - nodes_before;
 
-    int alpha = std::numeric_limits<int>::min() + 1;
-    int beta = std::numeric_limits<int>::max();
-    int best_score = std::numeric_limits<int>::min();
-    outBestMove = moves.front();
-
-    for (const auto& move : moves) {
-        MoveUndo undo = ApplyMove(board, move);
-        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
-        uint64_t nodes = 0;
-        uint64_t qnodes = 0;
-        int score = -Negamax(board,
-                             depth - 1,
-                             1,
-                             -beta,
-                             -alpha,
-                             std::chrono::steady_clock::time_point::max(),
-                             nodes,
-                             qnodes);
-        UndoMoveApply(board, undo);
-
-        if (score > best_score) {
-            best_score = score;
+        if (score == -kTimeOutScore) {
+            return kTimeOutScore;
+        }
+        if (i == first || score > alpha) {
+            root_move.score = score;
+        }
+        if (score > best) {
+            best = score;
             outBestMove = move;
+            UpdatePv(state.stack, 0, move);
         }
         if (score > alpha) {
             alpha = score;
         }
+        if (alpha >= beta) {
+            break;
+        }
     }
+    return best;
+}
 
-    return best_score;
+// Orders root moves for the next pass: moves that raised alpha by their score, the rest by
+// their previous iteration's score and then by node count, since moves that took longer to
+// refute are more likely to become best. The sort is stable, so ties keep their order. Moves
+// before first (lines already found in a MultiPV iteration) keep their places.
+void SortRootMoves(RootMoveList& root, int first) {
+    auto before = [](const RootMove& a, const RootMove& b) {
+        if (a.score != b.score) {
+            return a.score > b.score;
+        }
+        if (a.previous_score != b.previous_score) {
+            return a.previous_score > b.previous_score;
+        }
+        return a.nodes > b.nodes;
+    };
+    for (int i = first + 1; i < root.count; ++i) {
+        RootMove current = root.moves[i];
+        int j = i - 1;
+        while (j >= first && before(current, root.moves[j])) {
+            root.moves[j + 1] = root.moves[j];
+            --j;
+        }
+        root.moves[j + 1] = current;
+    }
 }
 
-int SearchBestMoveTimed(Board& board,
-                        int maxDepth,
-                        std::chrono::steady_clock::time_point deadline,
-                        Move& outBestMove,
-                        int& outDepth,
-                        uint64_t& outNodes,
-                        uint64_t& outQNodes) {
+// Starts a new iteration: the scores just found become the previous scores.
+void AgeRootMoves(RootMoveList& root) {
+    for (int i = 0; i < root.count; ++i) {
+        root.moves[i].previous_score = root.moves[i].score;
+    }
+}
+
+// After an interrupted pass, returns the move a completed full-window search proved better
+// than the move searched first, if there is one. With PVS only such a move raises alpha.
+const RootMove* ImprovedRootMove(const RootMoveList& root) {
+    const RootMove* improved = nullptr;
+    for (int i = 1; i < root.count; ++i) {
+        const RootMove& candidate = root.moves[i];
+        if (candidate.score > -kInfinity && (improved == nullptr || candidate.score > improved->score)) {
+            improved = &candidate;
+        }
+    }
+    return improved;
+}
+
+// Prepares a search: clears the killers and the previous PV and reserves enough hash
+// history for the deepest line so that make/unmake inside the tree never reallocates.
+SearchState BeginSearch(Board& board,
+                        const SearchLimits& limits,
+                        const std::atomic<bool>& stopRequested,
+                        const std::atomic<bool>& pondering,
+                        TranspositionTable& tt,
+                        SearchHeuristics& heuristics,
+                        SearchStack& stack,
+                        RootMoveList& rootMoves,
+                        MoveList& previousPv) {
+    for (auto& frame : stack) {
+        frame.killers.fill(Move());
+    }
+    previousPv.clear();
+    board.ReserveHistory(kMaxPly * 2);
+    return SearchState{std::chrono::steady_clock::now(),
+                       limits.hardDeadline,
+                       limits.softDeadline,
+                       limits.maxNodes,
+                       stopRequested,
+                       pondering,
+                       pondering.load(std::memory_order_acquire),
+                       0,
+                       0,
+                       tt,
+                       heuristics,
+                       stack,
+                       rootMoves,
+                       previousPv,
+                       0,
+                       kStopCheckInterval,
+                       false};
+}
+
+// In a tablebase position only the best-ranked root moves are searched. A win ranks by how
+// soon it mates or makes the winning pawn move (wins the fifty-move counter may still draw
+// rank lower) and a loss by how late, so every move played makes progress. Without
+// distances, the moves that keep the position's result are kept.
+void FilterTablebaseRootMoves(Board& board, SearchState& state) {
+    RootMoveList& root = state.root_moves;
+    std::array<int, kMaxMoves> ranks;
+    bool ranked = true;
+    for (int i = 0; i < root.count && ranked; ++i) {
+        int dtz = 0;
+        ranked = ProbeMoveDtz(board, root.moves[i].move, dtz);
+        ranks[i] = dtz > 0 ? (dtz + board.HalfmoveClock() <= 99 ? kMaxDtzRank : kMaxDtzRank / 2) - dtz
+            : dtz < 0 ? -kMaxDtzRank - dtz
+                      : 0;
+    }
+    if (!ranked) {
+        for (int i = 0; i < root.count; ++i) {
+            MoveUndo undo = ApplyMove(board, root.moves[i].move);
+            board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+            Wdl child;
+            ranks[i] = ProbeWdl(board, child) ? -static_cast<int>(child) : std::numeric_limits<int>::min();
+            UndoMoveApply(board, undo);
+        }
+    }
+    if (root.count == 0) {
+        return;
+    }
+    int best = *std::max_element(ranks.begin(), ranks.begin() + root.count);
+    if (best == std::numeric_limits<int>::min()) {
+        return;
+    }
+    state.tb_hits += 1;
+    int kept = 0;
+    for (int i = 0; i < root.count; ++i) {
+        if (ranks[i] == best) {
+            root.moves[kept++] = root.moves[i];
+        }
+    }
+    root.count = kept;
+}
+
+// Generates the root moves once per search, in the usual move ordering (TT move first).
+void PrepareRootMoves(Board& board, SearchState& state) {
+    SearchFrame& frame = state.stack[0];
+    GenerateNodeMoves(board, frame.moves, state);
+    Move tt_move;
+    bool has_tt_move = state.tt.PeekBestMove(board.Hash(), tt_move);
+    ScoreMoves(board, frame, has_tt_move ? &tt_move : nullptr, nullptr, 0);
+    SortMoves(frame);
+    RootMoveList& root = state.root_moves;
+    root.count = frame.moves.size();
+    for (int i = 0; i < root.count; ++i) {
+        root.moves[i] = RootMove{frame.moves[i], -kInfinity, -kInfinity, 0};
+    }
+
+    state.root_pieces = CountPieces(board);
+    if (state.root_pieces <= kTablebaseMaxPieces) {
+        FilterTablebaseRootMoves(board, state);
+    }
+}
+
+// Publishes a search result. Fields are assigned in place so that the vector of lines keeps
+// its capacity and repeated searches do not allocate.
+void PublishStats(SearchStats& stats,
+                  const SearchState& state,
+                  int depth,
+                  const MoveList& pv,
+                  const std::vector<PvLine>& lines) {
+    stats.nodes = state.nodes;
+    stats.qnodes = state.qnodes;
+    stats.depth = depth;
+    stats.seldepth = state.seldepth;
+    stats.tbhits = state.tb_hits;
+    stats.pv = pv;
+    stats.lines.assign(lines.begin(), lines.end());
+}
+
+#ifdef CHESSENGINE_SEARCH_STATS
+// Points the search at freshly reset counters.
+void AttachInstrumentation(SearchState& state, SearchInstrumentation& instrumentation) {
+    instrumentation = SearchInstrumentation{};
+    state.instrumentation = &instrumentation;
+}
+#endif
+}  // namespace
+
+struct SearchContext::Tables {
+    explicit Tables(size_t ttEntries) : tt(ttEntries) {
+        SEARCH_STAT(tt.SetInstrumentation(&instrumentation);)
+    }
+
+    TranspositionTable tt;
+    SearchHeuristics heuristics{};
+    SearchStack stack{};
+    RootMoveList root_moves{};
+    // Principal variation of the last completed iteration, followed first by the next one.
+    MoveList previous_pv{};
+    // MultiPV lines of the running iteration and of the last completed one; kept here so
+    // their capacity survives between searches.
+    std::vector<PvLine> lines;
+    std::vector<PvLine> best_lines;
+#ifdef CHESSENGINE_SEARCH_STATS
+    SearchInstrumentation instrumentation{};
+#endif
+};
+
+SearchContext::SearchContext(size_t ttEntries) : tables_(std::make_unique<Tables>(ttEntries)) {}
+
+SearchContext::~SearchContext() = default;
+
+void SearchContext::Clear() {
+    tables_->tt.Clear();
+    tables_->heuristics = SearchHeuristics{};
+    stats_ = SearchStats{};
+}
+
+void SearchContext::Stop() {
+    pondering_.store(false, std::memory_order_release);
+    stop_requested_.store(true, std::memory_order_relaxed);
+}
+
+void SearchContext::StartPondering() {
+    pondering_.store(true, std::memory_order_release);
+}
+
+void SearchContext::PonderHit() {
+    pondering_.store(false, std::memory_order_release);
+}
+
+const SearchStats& SearchContext::LastStats() const {
+    return stats_;
+}
+
+const SearchInstrumentation& SearchContext::LastInstrumentation() const {
+#ifdef CHESSENGINE_SEARCH_STATS
+    return tables_->instrumentation;
+#else
+    static const SearchInstrumentation empty{};
+    return empty;
+#endif
+}
+
+TranspositionTable& SearchContext::tt() {
+    return tables_->tt;
+}
+
+int EvaluateMaterial(const Board& board) {
+    return Evaluate(board);
+}
+
+int MateInMoves(int score) {
+    if (score > kMateThreshold) {
+        return (kCheckmateScore - score + 1) / 2;
+    }
+    if (score < -kMateThreshold) {
+        return -(kCheckmateScore + score) / 2;
+    }
+    return 0;
+}
+
+int SearchContext::SearchBestMove(Board& board, int depth, Move& outBestMove) {
+    stop_requested_.store(false, std::memory_order_relaxed);
+    SearchLimits limits;
+    limits.maxDepth = depth;
+    SearchState state = BeginSearch(board,
+                                    limits,
+                                    stop_requested_,
+                                    pondering_,
+                                    tables_->tt,
+                                    tables_->heuristics,
+                                    tables_->stack,
+                                    tables_->root_moves,
+                                    tables_->previous_pv);
+    SEARCH_STAT(AttachInstrumentation(state, tables_->instrumentation);
+                ScopedStatTimer total_timer(tables_->instrumentation.total_time);)
+    PrepareRootMoves(board, state);
+    if (state.root_moves.count == 0 || depth <= 0) {
+        return 0;
+    }
+
+    outBestMove = state.root_moves.moves[0].move;
+    int score = SearchRoot(board, depth, -kInfinity, kInfinity, state, 0, outBestMove);
+    SEARCH_STAT(state.instrumentation->iteration_nodes[std::min(depth, kStatsMaxDepth)] = state.nodes + state.qnodes;)
+    tables_->best_lines.assign(1, PvLine{score, state.stack[0].pv});
+    PublishStats(stats_, state, depth, state.stack[0].pv, tables_->best_lines);
+    return score;
+}
+
+int SearchContext::SearchBestMoveTimed(Board& board,
+                                       int maxDepth,
+                                       std::chrono::steady_clock::time_point deadline,
+                                       Move& outBestMove,
+                                       int& outDepth,
+                                       uint64_t& outNodes,
+                                       uint64_t& outQNodes) {
+    SearchLimits limits;
+    limits.maxDepth = maxDepth;
+    limits.hardDeadline = deadline;
+    return SearchBestMoveTimed(board, limits, outBestMove, outDepth, outNodes, outQNodes);
+}
+
+int SearchContext::SearchBestMoveTimed(Board& board,
+                                       const SearchLimits& limits,
+                                       Move& outBestMove,
+                                       int& outDepth,
+                                       uint64_t& outNodes,
+                                       uint64_t& outQNodes) {
     outNodes = 0;
     outQNodes = 0;
     outDepth = 0;
     int best_score = 0;
-    Move best_move(0, 0);
+    stop_requested_.store(false, std::memory_order_relaxed);
+    SearchState state = BeginSearch(board,
+                                    limits,
+                                    stop_requested_,
+                                    pondering_,
+                                    tables_->tt,
+                                    tables_->heuristics,
+                                    tables_->stack,
+                                    tables_->root_moves,
+                                    tables_->previous_pv);
+    SEARCH_STAT(AttachInstrumentation(state, tables_->instrumentation);
+                ScopedStatTimer total_timer(tables_->instrumentation.total_time);)
+    PrepareRootMoves(board, state);
+    RootMoveList& root = state.root_moves;
+    MoveList& best_pv = tables_->previous_pv;
+    Move best_move;
+    int stable_iterations = 0;
+    int line_count = std::clamp(limits.multiPv, 1, std::max(root.count, 1));
+    std::vector<PvLine>& lines = tables_->lines;
+    std::vector<PvLine>& best_lines = tables_->best_lines;
+    lines.resize(line_count);
+    best_lines.clear();
 
-    for (int depth = 1; depth <= maxDepth; ++depth) {
-        if (TimeUp(deadline)) {
+    for (int depth = 1; depth <= limits.maxDepth; ++depth) {
+        if (DeadlinePassed(state) || stop_requested_.load(std::memory_order_relaxed)) {
             break;
         }
-    auto moves = GenerateLegalMoves(board);
-    OrderMoves(board, moves, nullptr);
-        if (moves.empty()) {
+        if (root.count == 0) {
             break;
         }
-        int alpha = std::numeric_limits<int>::min() + 1;
-        int beta = std::numeric_limits<int>::max();
-        int local_best = std::numeric_limits<int>::min();
-        Move local_best_move = moves.front();
-        bool timed_out = false;
-
-        for (const auto& move : moves) {
-            MoveUndo undo = ApplyMove(board, move);
-            board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
-            int score = -Negamax(board, depth - 1, 1, -beta, -alpha, deadline, outNodes, outQNodes);
-            UndoMoveApply(board, undo);
+        AgeRootMoves(root);
+        SEARCH_STAT(uint64_t iteration_start_nodes = state.nodes + state.qnodes;)
 
-            if (score == -kTimeOutScore) {
-                timed_out = true;
-                break;
+        // MultiPV: line k searches the root again without the moves of lines 0..k-1, which
+        // the sort has placed in front. The passes share the TT, so later lines are cheap.
+        Move local_best_move = root.moves[0].move;
+        int score = 0;
+        int timed_out_line = -1;
+        bool failed_low = false;
+        for (int line = 0; line < line_count; ++line) {
+            // Aspiration window around the line's previous score; widen the failing side
+            // until the score lands inside, falling back to a full window for mate and
+            // tablebase scores.
+            int previous = line == 0 ? best_score : root.moves[line].previous_score;
+            int delta = kAspirationWindow;
+            int alpha = -kInfinity;
+            int beta = kInfinity;
+            if (depth >= kAspirationMinDepth && previous > -kTablebaseThreshold && previous < kTablebaseThreshold) {
+                alpha = previous - delta;
+                beta = previous + delta;
             }
 
-            if (score > local_best) {
-                local_best = score;
-                local_best_move = move;
+            Move line_move = root.moves[line].move;
+            int line_score = 0;
+            while (true) {
+                line_score = SearchRoot(board, depth, alpha, beta, state, line, line_move);
+                if (line_score == kTimeOutScore) {
+                    break;
+                }
+                SortRootMoves(root, line);
+                if (line_score <= alpha && alpha > -kInfinity) {
+                    failed_low = failed_low || line == 0;
+                    delta *= 2;
+                    alpha = std::max(line_score - delta, -kInfinity);
+                } else if (line_score >= beta && beta < kInfinity) {
+                    delta *= 2;
+                    beta = std::min(line_score + delta, kInfinity);
+                } else {
+                    break;
+                }
             }
-            if (score > alpha) {
-                alpha = score;
+            if (line_score == kTimeOutScore) {
+                timed_out_line = line;
+                break;
             }
+            if (line == 0) {
+                score = line_score;
+                local_best_move = line_move;
+            }
+            lines[line] = PvLine{line_score, state.stack[0].pv};
         }
 
-        if (timed_out) {
+        if (timed_out_line >= 0) {
+            // Keep a move the interrupted iteration already proved better than the one it
+            // started with; the depth is not counted as completed. It becomes the first of
+            // the previous iteration's lines, replacing its own older line or else the last
+            // one. An iteration interrupted in a later MultiPV line keeps the previous lines.
+            const RootMove* improved = timed_out_line == 0 ? ImprovedRootMove(root) : nullptr;
+            if (improved != nullptr && outDepth > 0) {
+                best_move = improved->move;
+                best_score = improved->score;
+                best_pv = state.stack[0].pv;
+                auto replaced = std::find_if(best_lines.begin(), best_lines.end(), [&](const PvLine& line) {
+                    return !line.pv.empty() && line.pv[0] == best_move;
+                });
+                if (replaced == best_lines.end()) {
+                    replaced = best_lines.end() - 1;
+                }
+                std::rotate(best_lines.begin(), replaced, replaced + 1);
+                best_lines[0] = PvLine{best_score, best_pv};
+            }
             break;
         }
 
-        best_score = local_best;
+        if (depth > 1 && score < best_score - kScoreDropMargin) {
+            failed_low = true;
+        }
+        stable_iterations = (depth > 1 && local_best_move == best_move) ? stable_iterations + 1 : 0;
+        best_score = score;
         best_move = local_best_move;
+        best_pv = lines[0].pv;
+        best_lines = lines;
         outDepth = depth;
+        SEARCH_STAT(state.instrumentation->iteration_nodes[depth] = state.nodes + state.qnodes - iteration_start_nodes;)
+        if (limits.onIteration) {
+            PublishStats(stats_, state, outDepth, best_pv, best_lines);
+            limits.onIteration(best_score, stats_);
+        }
+
+        DeadlinePassed(state);
+        if (!state.ponder_active && state.soft_deadline != std::chrono::steady_clock::time_point::max()) {
+            auto soft_budget = std::chrono::duration<double>(state.soft_deadline - state.start);
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.start);
+            if (elapsed >= soft_budget * SoftTimeScale(stable_iterations, failed_low)) {
+                break;
+            }
+        }
     }
 
+    outNodes = state.nodes;
+    outQNodes = state.qnodes;
+    PublishStats(stats_, state, outDepth, best_pv, best_lines);
     if (outDepth > 0) {
         outBestMove = best_move;
     }
     return best_score;
 }
+
+namespace {
+// Shared context behind the free functions, for single-game callers that do not manage
+// their own SearchContext.
+SearchContext& DefaultContext() {
+    static SearchContext context;
+    return context;
+}
+}  // namespace
+
+int SearchBestMove(Board& board, int depth, Move& outBestMove) {
+    return DefaultContext().SearchBestMove(board, depth, outBestMove);
+}
+
+int SearchBestMoveTimed(Board& board,
+                        int maxDepth,
+                        std::chrono::steady_clock::time_point deadline,
+                        Move& outBestMove,
+                        int& outDepth,
+                        uint64_t& outNodes,
+                        uint64_t& outQNodes) {
+    return DefaultContext().SearchBestMoveTimed(board, maxDepth, deadline, outBestMove, outDepth, outNodes, outQNodes);
+}
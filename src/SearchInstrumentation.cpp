@@ -0,0 +1,67 @@
+#include "SearchInstrumentation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+double Percent(uint64_t part, uint64_t whole) {
+    return whole > 0 ? 100.0 * static_cast<double>(part) / static_cast<double>(whole) : 0.0;
+}
+
+double Milliseconds(std::chrono::nanoseconds time) {
+    return std::chrono::duration<double, std::milli>(time).count();
+}
+}  // namespace
+
+void PrintSearchInstrumentation(const SearchInstrumentation& stats,
+                                std::ostream& out,
+                                const std::string& linePrefix) {
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    text << linePrefix << "tt probes " << stats.tt_probes << " hits " << stats.tt_hits << " ("
+         << Percent(stats.tt_hits, stats.tt_probes) << "%) cutoffs " << stats.tt_cutoffs << " ("
+         << Percent(stats.tt_cutoffs, stats.tt_probes) << "%) stores " << stats.tt_stores << " overwrites "
+         << stats.tt_overwrites << '\n';
+    text << linePrefix << "beta cutoffs " << stats.cutoffs << " first move " << stats.first_move_cutoffs << " ("
+         << Percent(stats.first_move_cutoffs, stats.cutoffs) << "%)\n";
+
+    // Effective branching factor: node growth from one iteration to the next.
+    text << linePrefix << "branching factor" << std::setprecision(2);
+    double product = 1.0;
+    int factors = 0;
+    for (int depth = 2; depth <= kStatsMaxDepth; ++depth) {
+        uint64_t previous = stats.iteration_nodes[depth - 1];
+        uint64_t current = stats.iteration_nodes[depth];
+        if (previous == 0 || current == 0) {
+            continue;
+        }
+        double factor = static_cast<double>(current) / static_cast<double>(previous);
+        text << " d" << depth << ' ' << factor;
+        product *= factor;
+        factors += 1;
+    }
+    if (factors > 0) {
+        text << " mean " << std::pow(product, 1.0 / factors);
+    }
+    text << '\n' << std::setprecision(1);
+
+    text << linePrefix << "qsearch depth";
+    for (int depth = 0; depth < kStatsQsearchDepths; ++depth) {
+        if (stats.qsearch_depth[depth] > 0) {
+            text << ' ' << depth << (depth + 1 == kStatsQsearchDepths ? "+:" : ":") << stats.qsearch_depth[depth];
+        }
+    }
+    text << '\n';
+
+    std::chrono::nanoseconds search_time =
+        std::max(stats.total_time - stats.movegen_time - stats.eval_time, std::chrono::nanoseconds(0));
+    uint64_t total = static_cast<uint64_t>(stats.total_time.count());
+    text << linePrefix << "time movegen " << Milliseconds(stats.movegen_time) << "ms ("
+         << Percent(static_cast<uint64_t>(stats.movegen_time.count()), total) << "%) eval "
+         << Milliseconds(stats.eval_time) << "ms (" << Percent(static_cast<uint64_t>(stats.eval_time.count()), total)
+         << "%) search " << Milliseconds(search_time) << "ms ("
+         << Percent(static_cast<uint64_t>(search_time.count()), total) << "%)\n";
+    out << text.str();
+}
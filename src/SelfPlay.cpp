@@ -0,0 +1,296 @@
+#include "SelfPlay.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "Search.h"
+#include "TimeManager.h"
+#include "TranspositionTable.h"
+
+namespace {
+// Used when a configuration sets no limit at all.
+const int kDefaultMatchDepth = 6;
+
+enum class GameResult { WhiteWins, BlackWins, Draw };
+
+struct GameOutcome {
+    GameResult result = GameResult::Draw;
+    std::string reason;
+    int plies = 0;
+};
+
+// No pawns, rooks or queens and at most one minor piece: neither side can mate.
+bool InsufficientMaterial(const Board& board) {
+    int minors = 0;
+    for (int square = 0; square < 64; ++square) {
+        char piece = static_cast<char>(std::tolower(static_cast<unsigned char>(board.PieceAt(square))));
+        if (piece == 'p' || piece == 'r' || piece == 'q') {
+            return false;
+        }
+        if (piece == 'n' || piece == 'b') {
+            minors += 1;
+        }
+    }
+    return minors <= 1;
+}
+
+SearchLimits MoveLimits(const EngineConfig& config,
+                        const TimeControl& clock,
+                        std::chrono::steady_clock::time_point start) {
+    SearchLimits limits;
+    bool limited = config.depth > 0 || config.nodes > 0 || config.moveTime.count() > 0 || config.baseTime.count() > 0;
+    limits.maxDepth = std::clamp(config.depth > 0 ? config.depth : (limited ? kMaxSearchDepth : kDefaultMatchDepth),
+                                 1,
+                                 kMaxSearchDepth);
+    limits.maxNodes = config.nodes;
+    if (config.moveTime.count() > 0) {
+        limits.hardDeadline = start + config.moveTime;
+    }
+    if (config.baseTime.count() > 0) {
+        TimeBudget budget = AllocateTime(clock);
+        limits.softDeadline = start + budget.soft;
+        limits.hardDeadline = std::min(limits.hardDeadline, start + budget.hard);
+    }
+    return limits;
+}
+
+GameOutcome PlayGame(const std::string& fen,
+                     const EngineConfig& white,
+                     const EngineConfig& black,
+                     SearchContext& whiteSearch,
+                     SearchContext& blackSearch,
+                     const MatchOptions& options) {
+    Board board;
+    board.LoadFen(fen);
+    whiteSearch.Clear();
+    blackSearch.Clear();
+    TimeControl clocks[2];
+    clocks[0].remaining = white.baseTime;
+    clocks[0].increment = white.increment;
+    clocks[1].remaining = black.baseTime;
+    clocks[1].increment = black.increment;
+
+    GameOutcome outcome;
+    for (int ply = 0;; ++ply) {
+        outcome.plies = ply;
+        bool white_to_move = board.SideToMove() == 'w';
+        GameResult mover_wins = white_to_move ? GameResult::WhiteWins : GameResult::BlackWins;
+        GameResult mover_loses = white_to_move ? GameResult::BlackWins : GameResult::WhiteWins;
+        std::vector<Move> legal = GenerateLegalMoves(board);
+        if (legal.empty()) {
+            bool mated = InCheck(board, white_to_move ? Color::White : Color::Black);
+            outcome.result = mated ? mover_loses : GameResult::Draw;
+            outcome.reason = mated ? "checkmate" : "stalemate";
+            return outcome;
+        }
+        if (board.IsRepetition(2)) {
+            outcome.reason = "repetition";
+            return outcome;
+        }
+        if (board.IsFiftyMoveDraw()) {
+            outcome.reason = "fifty-move rule";
+            return outcome;
+        }
+        if (InsufficientMaterial(board)) {
+            outcome.reason = "insufficient material";
+            return outcome;
+        }
+        if (ply >= options.maxPlies) {
+            outcome.reason = "move limit";
+            return outcome;
+        }
+
+        const EngineConfig& config = white_to_move ? white : black;
+        SearchContext& search = white_to_move ? whiteSearch : blackSearch;
+        TimeControl& clock = clocks[white_to_move ? 0 : 1];
+        auto start = std::chrono::steady_clock::now();
+        SearchLimits limits = MoveLimits(config, clock, start);
+        Move best;
+        int depth = 0;
+        uint64_t nodes = 0;
+        uint64_t qnodes = 0;
+        int score = search.SearchBestMoveTimed(board, limits, best, depth, nodes, qnodes);
+        if (config.baseTime.count() > 0) {
+            auto spent =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            if (spent > clock.remaining) {
+                outcome.result = mover_loses;
+                outcome.reason = "time forfeit";
+                return outcome;
+            }
+            clock.remaining = clock.remaining - spent + clock.increment;
+        }
+        if (depth == 0) {
+            best = legal.front();
+        } else if (options.adjudicateMates && MateInMoves(score) != 0) {
+            outcome.result = MateInMoves(score) > 0 ? mover_wins : mover_loses;
+            outcome.reason = "adjudicated mate";
+            return outcome;
+        }
+        MoveUndo undo = ApplyMove(board, best);
+        board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    }
+}
+
+double EloFromScore(double score) {
+    score = std::clamp(score, 1e-6, 1.0 - 1e-6);
+    return -400.0 * std::log10(1.0 / score - 1.0);
+}
+
+double ScoreFromElo(double elo) {
+    return 1.0 / (1.0 + std::pow(10.0, -elo / 400.0));
+}
+
+const char* ResultText(GameResult result) {
+    switch (result) {
+        case GameResult::WhiteWins:
+            return "1-0";
+        case GameResult::BlackWins:
+            return "0-1";
+        default:
+            return "1/2-1/2";
+    }
+}
+}  // namespace
+
+bool ParseEngineConfig(const std::string& spec, EngineConfig& config) {
+    std::istringstream items(spec);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string key = item.substr(0, equals);
+        std::string value = item.substr(equals + 1);
+        if (key == "name") {
+            config.name = value;
+        } else if (key == "depth") {
+            config.depth = std::atoi(value.c_str());
+        } else if (key == "nodes") {
+            config.nodes = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (key == "movetime") {
+            config.moveTime = std::chrono::milliseconds(std::atoi(value.c_str()));
+        } else if (key == "tc") {
+            size_t plus = value.find('+');
+            double base = std::atof(value.substr(0, plus).c_str());
+            double increment = plus == std::string::npos ? 0.0 : std::atof(value.substr(plus + 1).c_str());
+            config.baseTime = std::chrono::milliseconds(static_cast<long long>(base * 1000.0));
+            config.increment = std::chrono::milliseconds(static_cast<long long>(increment * 1000.0));
+        } else if (key == "hash") {
+            config.hashMb = std::max(std::atoi(value.c_str()), 1);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UpdateMatchStatistics(MatchResult& result, const SprtOptions& sprt) {
+    result.games = result.wins + result.losses + result.draws;
+    result.lowerBound = std::log(sprt.beta / (1.0 - sprt.alpha));
+    result.upperBound = std::log((1.0 - sprt.beta) / sprt.alpha);
+    if (result.games == 0) {
+        return;
+    }
+    double n = result.games;
+    double score = (result.wins + 0.5 * result.draws) / n;
+    double variance = (result.wins * std::pow(1.0 - score, 2) + result.draws * std::pow(0.5 - score, 2) +
+                       result.losses * std::pow(score, 2)) /
+                      n;
+    double deviation = std::sqrt(variance / n);
+    result.elo = EloFromScore(score);
+    result.eloMargin = (EloFromScore(score + 1.96 * deviation) - EloFromScore(score - 1.96 * deviation)) / 2.0;
+
+    // Generalized SPRT with the normal approximation of the trinomial score distribution.
+    result.llr = 0.0;
+    if (variance > 0.0) {
+        double s0 = ScoreFromElo(sprt.elo0);
+        double s1 = ScoreFromElo(sprt.elo1);
+        result.llr = n * (s1 - s0) * (2.0 * score - s0 - s1) / (2.0 * variance);
+    }
+    result.decision = SprtDecision::Continue;
+    if (sprt.enabled) {
+        if (result.llr >= result.upperBound) {
+            result.decision = SprtDecision::AcceptH1;
+        } else if (result.llr <= result.lowerBound) {
+            result.decision = SprtDecision::AcceptH0;
+        }
+    }
+}
+
+MatchResult RunMatch(const std::vector<std::string>& openings,
+                     const EngineConfig& a,
+                     const EngineConfig& b,
+                     const MatchOptions& options,
+                     std::ostream& log) {
+    MatchResult result;
+    UpdateMatchStatistics(result, options.sprt);
+    if (openings.empty()) {
+        return result;
+    }
+    const int pairs = (std::max(options.games, 1) + 1) / 2;
+    std::atomic<int> next_pair{0};
+    std::atomic<bool> finished{false};
+    std::mutex result_mutex;
+
+    auto work = [&] {
+        SearchContext search_a(TTEntriesForMegabytes(a.hashMb));
+        SearchContext search_b(TTEntriesForMegabytes(b.hashMb));
+        while (!finished.load()) {
+            int pair = next_pair.fetch_add(1);
+            if (pair >= pairs) {
+                return;
+            }
+            int opening = pair % static_cast<int>(openings.size());
+            for (int leg = 0; leg < 2 && !finished.load(); ++leg) {
+                bool a_white = leg == 0;
+                GameOutcome outcome = a_white
+                    ? PlayGame(openings[opening], a, b, search_a, search_b, options)
+                    : PlayGame(openings[opening], b, a, search_b, search_a, options);
+
+                std::lock_guard<std::mutex> lock(result_mutex);
+                if (finished.load()) {
+                    return;
+                }
+                if (outcome.result == GameResult::Draw) {
+                    result.draws += 1;
+                } else if ((outcome.result == GameResult::WhiteWins) == a_white) {
+                    result.wins += 1;
+                } else {
+                    result.losses += 1;
+                }
+                UpdateMatchStatistics(result, options.sprt);
+                log << std::fixed << std::setprecision(2) << "Game " << result.games << " (pair " << pair + 1
+                    << ", opening " << opening + 1 << "): " << (a_white ? a.name : b.name) << " - "
+                    << (a_white ? b.name : a.name) << ' ' << ResultText(outcome.result) << " (" << outcome.reason
+                    << ", " << outcome.plies << " plies)  score +" << result.wins << " -" << result.losses << " ="
+                    << result.draws << ", elo " << result.elo << " +/- " << result.eloMargin << ", llr " << result.llr
+                    << " [" << result.lowerBound << ", " << result.upperBound << "]\n";
+                if (result.decision != SprtDecision::Continue || result.games >= pairs * 2) {
+                    finished.store(true);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < std::max(options.concurrency, 1); ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    return result;
+}
@@ -0,0 +1,439 @@
+#include "Tablebase.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "MoveGen.h"
+
+namespace {
+int FileOf(int square) {
+    return square % 8;
+}
+
+int RankOf(int square) {
+    return square / 8;
+}
+
+int Distance(int a, int b) {
+    return std::max(std::abs(FileOf(a) - FileOf(b)), std::abs(RankOf(a) - RankOf(b)));
+}
+
+template <typename Visit>
+void ForEachNeighbour(int square, Visit visit) {
+    for (int rank = std::max(RankOf(square) - 1, 0); rank <= std::min(RankOf(square) + 1, 7); ++rank) {
+        for (int file = std::max(FileOf(square) - 1, 0); file <= std::min(FileOf(square) + 1, 7); ++file) {
+            if (rank * 8 + file != square) {
+                visit(rank * 8 + file);
+            }
+        }
+    }
+}
+
+// True if a white pawn on pawn attacks square.
+bool PawnAttacks(int pawn, int square) {
+    return RankOf(square) == RankOf(pawn) + 1 && std::abs(FileOf(square) - FileOf(pawn)) == 1;
+}
+
+// King and pawn against king, with the pawn white and on files a-d (other positions are
+// mirrored onto these). Entries are indexed by pawn (24 squares), white king, black king and
+// side to move; the bit is set where white wins.
+const int kKpkPawnSquares = 24;
+const size_t kKpkSize = static_cast<size_t>(kKpkPawnSquares) * 64 * 64 * 2;
+
+size_t KpkIndex(bool whiteToMove, int whiteKing, int blackKing, int pawn) {
+    int pawn_index = (RankOf(pawn) - 1) * 4 + FileOf(pawn);
+    return ((static_cast<size_t>(pawn_index) * 64 + whiteKing) * 64 + blackKing) * 2 + (whiteToMove ? 0 : 1);
+}
+
+enum KpkResult : uint8_t { kInvalid = 0, kUnknown = 1, kDraw = 2, kWin = 4 };
+
+class KpkBitbase {
+public:
+    KpkBitbase() {
+        std::vector<uint8_t> results(kKpkSize, kUnknown);
+        ForEach([&](bool white, int wk, int bk, int pawn) {
+            results[KpkIndex(white, wk, bk, pawn)] = Initial(white, wk, bk, pawn);
+        });
+        // Resolve positions from their successors until nothing changes.
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            ForEach([&](bool white, int wk, int bk, int pawn) {
+                uint8_t& result = results[KpkIndex(white, wk, bk, pawn)];
+                if (result == kUnknown) {
+                    result = Classify(results, white, wk, bk, pawn);
+                    changed = changed || result != kUnknown;
+                }
+            });
+        }
+        for (size_t i = 0; i < kKpkSize; ++i) {
+            wins_[i] = results[i] == kWin;
+        }
+    }
+
+    bool WhiteWins(bool whiteToMove, int whiteKing, int blackKing, int pawn) const {
+        return wins_[KpkIndex(whiteToMove, whiteKing, blackKing, pawn)];
+    }
+
+private:
+    template <typename Visit>
+    static void ForEach(Visit visit) {
+        for (int pawn_index = 0; pawn_index < kKpkPawnSquares; ++pawn_index) {
+            int pawn = (pawn_index / 4 + 1) * 8 + pawn_index % 4;
+            for (int wk = 0; wk < 64; ++wk) {
+                for (int bk = 0; bk < 64; ++bk) {
+                    visit(true, wk, bk, pawn);
+                    visit(false, wk, bk, pawn);
+                }
+            }
+        }
+    }
+
+    static uint8_t Initial(bool white, int wk, int bk, int pawn) {
+        if (Distance(wk, bk) <= 1 || wk == pawn || bk == pawn || (white && PawnAttacks(pawn, bk))) {
+            return kInvalid;
+        }
+        int promotion = pawn + 8;
+        // The pawn queens and the queen cannot be taken.
+        if (white && RankOf(pawn) == 6 && wk != promotion && bk != promotion &&
+            (Distance(bk, promotion) > 1 || Distance(wk, promotion) == 1)) {
+            return kWin;
+        }
+        if (!white) {
+            bool can_move = false;
+            ForEachNeighbour(bk, [&](int to) {
+                can_move = can_move || (Distance(wk, to) > 1 && !PawnAttacks(pawn, to));
+            });
+            // Stalemate, or the pawn falls.
+            if (!can_move || (Distance(bk, pawn) == 1 && Distance(wk, pawn) > 1)) {
+                return kDraw;
+            }
+        }
+        return kUnknown;
+    }
+
+    // White wins if some move wins; black draws if some move draws. Illegal successors are
+    // kInvalid and count for neither.
+    static uint8_t Classify(const std::vector<uint8_t>& results, bool white, int wk, int bk, int pawn) {
+        uint8_t any = 0;
+        if (white) {
+            ForEachNeighbour(wk, [&](int to) { any |= results[KpkIndex(false, to, bk, pawn)]; });
+            int push = pawn + 8;
+            // Promotions are covered by the initial classification.
+            if (RankOf(pawn) < 6 && push != wk && push != bk) {
+                any |= results[KpkIndex(false, wk, bk, push)];
+                if (RankOf(pawn) == 1 && push + 8 != wk && push + 8 != bk) {
+                    any |= results[KpkIndex(false, wk, bk, push + 8)];
+                }
+            }
+            return any & kWin ? kWin : any & kUnknown ? kUnknown : kDraw;
+        }
+        ForEachNeighbour(bk, [&](int to) { any |= results[KpkIndex(true, wk, to, pawn)]; });
+        return any & kDraw ? kDraw : any & kUnknown ? kUnknown : kWin;
+    }
+
+    std::bitset<kKpkSize> wins_;
+};
+
+const KpkBitbase& Kpk() {
+    static const KpkBitbase bitbase;
+    return bitbase;
+}
+
+// Whether a queen or rook on from attacks square; only blocker can stand in the way.
+bool SliderAttacks(char piece, int from, int square, int blocker) {
+    int file_step = FileOf(square) - FileOf(from);
+    int rank_step = RankOf(square) - RankOf(from);
+    bool straight = file_step == 0 || rank_step == 0;
+    bool diagonal = std::abs(file_step) == std::abs(rank_step);
+    if (from == square || !(straight || (piece == 'q' && diagonal))) {
+        return false;
+    }
+    int step = (rank_step > 0 ? 8 : rank_step < 0 ? -8 : 0) + (file_step > 0 ? 1 : file_step < 0 ? -1 : 0);
+    for (int current = from + step; current != square; current += step) {
+        if (current == blocker) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// King and queen or rook against king, from the strong side's point of view.
+Wdl ProbeMajor(char piece, int strongKing, int weakKing, int pieceSquare, bool strongToMove) {
+    if (strongToMove) {
+        return Wdl::Win;
+    }
+    if (Distance(weakKing, pieceSquare) == 1 && Distance(strongKing, pieceSquare) > 1) {
+        return Wdl::Draw;
+    }
+    bool can_move = false;
+    ForEachNeighbour(weakKing, [&](int to) {
+        can_move = can_move ||
+            (to != pieceSquare && Distance(strongKing, to) > 1 && !SliderAttacks(piece, pieceSquare, to, strongKing));
+    });
+    if (can_move) {
+        return Wdl::Win;
+    }
+    // No move: mate if in check, else stalemate.
+    return SliderAttacks(piece, pieceSquare, weakKing, strongKing) ? Wdl::Win : Wdl::Draw;
+}
+
+// Plies to the end of a won ending of king and queen, rook or pawn against king: to mate, or
+// for a pawn to the push that keeps the win. Entries are indexed by piece, strong king, weak
+// king and side to move, the pawn only on files a-d. Levels are resolved in order: the
+// defender's positions one ply after the last of their successors is, the strong side's one
+// ply after the first; positions the strong side does not win stay unresolved.
+const size_t kDistanceSize = size_t{64} * 64 * 64 * 2;
+const uint8_t kUnresolved = 0xFF;
+
+size_t DistanceIndex(bool strongToMove, int strongKing, int weakKing, int piece) {
+    return ((static_cast<size_t>(piece) * 64 + strongKing) * 64 + weakKing) * 2 + (strongToMove ? 0 : 1);
+}
+
+class DistanceTable {
+public:
+    explicit DistanceTable(char piece) : piece_(piece), plies_(kDistanceSize, kUnresolved) {
+        // No level is empty below the longest win, except for the mates of a pawn ending.
+        bool changed = true;
+        for (int level = 0; changed || level < 2; ++level) {
+            changed = false;
+            bool strong = level % 2 == 1;
+            for (int square = 0; square < 64; ++square) {
+                for (int sk = 0; sk < 64; ++sk) {
+                    for (int wk = 0; wk < 64; ++wk) {
+                        uint8_t& plies = plies_[DistanceIndex(strong, sk, wk, square)];
+                        if (plies == kUnresolved && Valid(strong, sk, wk, square) &&
+                            (strong ? StrongResolves(level, sk, wk, square) : WeakResolves(level, sk, wk, square))) {
+                            plies = static_cast<uint8_t>(level);
+                            changed = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // -1 where the strong side does not win.
+    int Plies(bool strongToMove, int strongKing, int weakKing, int piece) const {
+        uint8_t plies = plies_[DistanceIndex(strongToMove, strongKing, weakKing, piece)];
+        return plies == kUnresolved ? -1 : plies;
+    }
+
+private:
+    bool Attacks(int strongKing, int piece, int square) const {
+        return piece_ == 'p' ? PawnAttacks(piece, square) : SliderAttacks(piece_, piece, square, strongKing);
+    }
+
+    bool Valid(bool strong, int sk, int wk, int piece) const {
+        if (Distance(sk, wk) <= 1 || piece == sk || piece == wk) {
+            return false;
+        }
+        if (piece_ == 'p' && (RankOf(piece) < 1 || RankOf(piece) > 6 || FileOf(piece) > 3)) {
+            return false;
+        }
+        return !strong || !Attacks(sk, piece, wk);
+    }
+
+    // Every move of the defender loses, and the slowest loss is resolved; or it is mated.
+    bool WeakResolves(int level, int sk, int wk, int piece) const {
+        bool can_move = false;
+        bool resolved = true;
+        ForEachNeighbour(wk, [&](int to) {
+            if (Distance(sk, to) <= 1 || (to != piece && Attacks(sk, piece, to))) {
+                return;
+            }
+            can_move = true;
+            // Taking the undefended piece draws.
+            resolved = resolved && to != piece && plies_[DistanceIndex(true, sk, to, piece)] != kUnresolved;
+        });
+        if (!can_move) {
+            return level == 0 && Attacks(sk, piece, wk);
+        }
+        return level > 0 && resolved;
+    }
+
+    // Some move of the strong side reaches a loss of the level before, or a pawn move wins.
+    bool StrongResolves(int level, int sk, int wk, int piece) const {
+        bool resolves = level == 1 && piece_ == 'p' && WinningPush(sk, wk, piece);
+        auto reaches = [&](int king, int to) {
+            resolves = resolves || plies_[DistanceIndex(false, king, wk, to)] == level - 1;
+        };
+        ForEachNeighbour(sk, [&](int to) {
+            if (Distance(to, wk) > 1 && to != piece) {
+                reaches(to, piece);
+            }
+        });
+        if (piece_ == 'p') {
+            return resolves;
+        }
+        static const int kSteps[8][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+        for (int direction = 0; direction < (piece_ == 'q' ? 8 : 4); ++direction) {
+            int file = FileOf(piece) + kSteps[direction][0];
+            int rank = RankOf(piece) + kSteps[direction][1];
+            for (; file >= 0 && file < 8 && rank >= 0 && rank < 8; file += kSteps[direction][0], rank += kSteps[direction][1]) {
+                int to = rank * 8 + file;
+                if (to == sk || to == wk) {
+                    break;
+                }
+                reaches(sk, to);
+            }
+        }
+        return resolves;
+    }
+
+    // A push, or a promotion to queen or rook, that keeps the win.
+    static bool WinningPush(int sk, int wk, int pawn) {
+        int push = pawn + 8;
+        if (push == sk || push == wk) {
+            return false;
+        }
+        if (RankOf(pawn) == 6) {
+            return ProbeMajor('q', sk, wk, push, false) == Wdl::Win || ProbeMajor('r', sk, wk, push, false) == Wdl::Win;
+        }
+        if (Kpk().WhiteWins(false, sk, wk, push)) {
+            return true;
+        }
+        return RankOf(pawn) == 1 && push + 8 != sk && push + 8 != wk && Kpk().WhiteWins(false, sk, wk, push + 8);
+    }
+
+    char piece_;
+    std::vector<uint8_t> plies_;
+};
+
+const DistanceTable& Distances(char piece) {
+    if (piece == 'q') {
+        static const DistanceTable queen('q');
+        return queen;
+    }
+    if (piece == 'r') {
+        static const DistanceTable rook('r');
+        return rook;
+    }
+    static const DistanceTable pawn('p');
+    return pawn;
+}
+
+// A position of at most three pieces from the side of its one piece besides the kings: ranks
+// are flipped for a black pawn and files e-h mirrored onto d-a for any pawn.
+struct Ending {
+    // The piece in lowercase; '.' for two bare kings.
+    char type = '.';
+    bool strong_to_move = false;
+    int strong_king = -1;
+    int weak_king = -1;
+    int piece = -1;
+};
+
+bool FindEnding(const Board& board, Ending& out) {
+    int kings[2] = {-1, -1};
+    int king_count = 0;
+    int extra_square = -1;
+    char extra = '.';
+    int count = 0;
+    for (int square = 0; square < 64; ++square) {
+        char piece = board.PieceAt(square);
+        if (piece == '.') {
+            continue;
+        }
+        if (++count > kTablebaseMaxPieces) {
+            return false;
+        }
+        if (piece == 'K' || piece == 'k') {
+            kings[piece == 'K' ? 0 : 1] = square;
+            king_count += 1;
+        } else {
+            extra = piece;
+            extra_square = square;
+        }
+    }
+    if (king_count != 2 || kings[0] < 0 || kings[1] < 0) {
+        return false;
+    }
+    out = Ending();
+    if (extra_square < 0) {
+        return true;
+    }
+    bool strong_white = std::isupper(static_cast<unsigned char>(extra)) != 0;
+    out.type = static_cast<char>(std::tolower(static_cast<unsigned char>(extra)));
+    out.strong_to_move = (board.SideToMove() == 'w') == strong_white;
+    int flip = 0;
+    int mirror = 0;
+    if (out.type == 'p') {
+        flip = strong_white ? 0 : 56;
+        mirror = FileOf(extra_square) > 3 ? 7 : 0;
+    }
+    out.strong_king = kings[strong_white ? 0 : 1] ^ flip ^ mirror;
+    out.weak_king = kings[strong_white ? 1 : 0] ^ flip ^ mirror;
+    out.piece = extra_square ^ flip ^ mirror;
+    return out.type != 'p' || (RankOf(out.piece) >= 1 && RankOf(out.piece) <= 6);
+}
+}  // namespace
+
+int CountPieces(const Board& board) {
+    int count = 0;
+    for (int square = 0; square < 64; ++square) {
+        count += board.PieceAt(square) != '.' ? 1 : 0;
+    }
+    return count;
+}
+
+bool ProbeWdl(const Board& board, Wdl& outResult) {
+    Ending ending;
+    if (!FindEnding(board, ending)) {
+        return false;
+    }
+    Wdl strong = Wdl::Draw;
+    if (ending.type == 'q' || ending.type == 'r') {
+        strong = ProbeMajor(ending.type, ending.strong_king, ending.weak_king, ending.piece, ending.strong_to_move);
+    } else if (ending.type == 'p') {
+        bool wins = Kpk().WhiteWins(ending.strong_to_move, ending.strong_king, ending.weak_king, ending.piece);
+        strong = wins ? Wdl::Win : Wdl::Draw;
+    }
+    outResult = ending.strong_to_move ? strong : static_cast<Wdl>(-static_cast<int>(strong));
+    return true;
+}
+
+bool ProbeDtz(const Board& board, int& outDtz) {
+    Ending ending;
+    Wdl wdl = Wdl::Draw;
+    if (board.CastlingMask() != 0 || !FindEnding(board, ending) || !ProbeWdl(board, wdl)) {
+        return false;
+    }
+    if (wdl == Wdl::Draw) {
+        outDtz = 0;
+        return true;
+    }
+    int plies = Distances(ending.type).Plies(ending.strong_to_move, ending.strong_king, ending.weak_king, ending.piece);
+    if (plies < 0) {
+        return false;
+    }
+    // The mated side is one ply from the end as well.
+    outDtz = wdl == Wdl::Win ? plies : -std::max(plies, 1);
+    return true;
+}
+
+bool ProbeMoveDtz(Board& board, const Move& move, int& outDtz) {
+    if (board.CastlingMask() != 0) {
+        return false;
+    }
+    MoveUndo undo = ApplyMove(board, move);
+    board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    int dtz = 0;
+    bool known = false;
+    if (board.HalfmoveClock() == 0) {
+        Wdl wdl = Wdl::Draw;
+        known = ProbeWdl(board, wdl);
+        dtz = -static_cast<int>(wdl);
+    } else {
+        known = ProbeDtz(board, dtz);
+        // Only a mated position stands at -1: mating ends the game in one ply.
+        dtz = dtz == -1 ? 1 : dtz < 0 ? 1 - dtz : dtz > 0 ? -1 - dtz : 0;
+    }
+    UndoMoveApply(board, undo);
+    outDtz = dtz;
+    return known;
+}
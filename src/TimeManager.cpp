@@ -0,0 +1,46 @@
+#include "TimeManager.h"
+
+#include <algorithm>
+
+namespace {
+// Expected number of moves left in a sudden-death game.
+const int kDefaultMovesToGo = 40;
+const int kMaxMovesToGo = 50;
+// Never plan to spend more than this share of the clock on one move.
+const double kMaxSoftShare = 0.5;
+const double kMaxHardShare = 0.75;
+const double kLastMoveShare = 0.9;
+const int kHardToSoftRatio = 4;
+}  // namespace
+
+TimeBudget AllocateTime(const TimeControl& control) {
+    using std::chrono::milliseconds;
+    milliseconds available = std::max(control.remaining - control.moveOverhead, milliseconds(1));
+    int moves_to_go = control.movesToGo > 0 ? std::min(control.movesToGo, kMaxMovesToGo) : kDefaultMovesToGo;
+
+    double soft_share = moves_to_go == 1 ? kLastMoveShare : kMaxSoftShare;
+    double hard_share = moves_to_go == 1 ? kLastMoveShare : kMaxHardShare;
+    auto soft_cap = milliseconds(static_cast<long long>(available.count() * soft_share));
+    auto hard_cap = milliseconds(static_cast<long long>(available.count() * hard_share));
+
+    TimeBudget budget;
+    budget.soft = std::min(available / moves_to_go + control.increment * 3 / 4, soft_cap);
+    budget.soft = std::max(budget.soft, milliseconds(1));
+    budget.hard = std::clamp(budget.soft * kHardToSoftRatio, budget.soft, std::max(hard_cap, budget.soft));
+    return budget;
+}
+
+double SoftTimeScale(int stableIterations, bool failedLow) {
+    double scale = 1.0;
+    if (stableIterations == 0) {
+        scale = 1.3;
+    } else if (stableIterations >= 4) {
+        scale = 0.5;
+    } else if (stableIterations >= 2) {
+        scale = 0.75;
+    }
+    if (failedLow) {
+        scale *= 1.5;
+    }
+    return std::min(scale, 2.0);
+}
@@ -1,5 +1,16 @@
 #include "TranspositionTable.h"
 
+#include <algorithm>
+
+size_t TTEntriesForMegabytes(int megabytes) {
+    size_t bytes = static_cast<size_t>(megabytes) * 1024 * 1024;
+    size_t entries = 1;
+    while (entries * 2 * sizeof(TTEntry) <= bytes) {
+        entries *= 2;
+    }
+    return entries;
+}
+
 TranspositionTable::TranspositionTable(size_t size_power_of_two)
     : mask_(size_power_of_two - 1), entries_(size_power_of_two) {}
 
@@ -16,7 +27,12 @@ bool TranspositionTable::Probe(uint64_t key,
                                int& outScore,
                                Move& outBestMove) const {
     const TTEntry& entry = entries_[key & mask_];
-    if (entry.depth < 0 || entry.key != key || entry.depth < depth) {
+    SEARCH_STAT(if (stats_ != nullptr) { stats_->tt_probes += 1; })
+    if (entry.depth < 0 || entry.key != key) {
+        return false;
+    }
+    SEARCH_STAT(if (stats_ != nullptr) { stats_->tt_hits += 1; })
+    if (entry.depth < depth) {
         return false;
     }
 
@@ -37,6 +53,7 @@ bool TranspositionTable::Probe(uint64_t key,
     if (entry.hasBestMove) {
         outBestMove = entry.bestMove;
     }
+    SEARCH_STAT(if (stats_ != nullptr) { stats_->tt_cutoffs += 1; })
     return true;
 }
 
@@ -45,6 +62,12 @@ void TranspositionTable::Store(uint64_t key, int depth, int score, Bound bound,
     if (entry.depth >= depth && entry.key == key) {
         return;
     }
+    SEARCH_STAT(if (stats_ != nullptr) {
+        stats_->tt_stores += 1;
+        if (entry.depth >= 0 && entry.key != key) {
+            stats_->tt_overwrites += 1;
+        }
+    })
 
     entry.key = key;
     entry.depth = depth;
@@ -66,3 +89,14 @@ bool TranspositionTable::PeekBestMove(uint64_t key, Move& outBestMove) const {
     outBestMove = entry.bestMove;
     return true;
 }
+
+int TranspositionTable::Hashfull() const {
+    size_t sample = std::min<size_t>(entries_.size(), 1000);
+    size_t used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        if (entries_[i].depth >= 0) {
+            used += 1;
+        }
+    }
+    return static_cast<int>(used * 1000 / sample);
+}
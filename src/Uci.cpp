@@ -0,0 +1,353 @@
+#include "Uci.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Board.h"
+#include "MoveGen.h"
+#include "PolyglotBook.h"
+#include "Search.h"
+#include "TimeManager.h"
+
+namespace {
+const char* const kStartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+const int kDefaultHashMb = 64;
+const int kMaxHashMb = 4096;
+
+// Finds the legal move with the given UCI text, so that castling and promotion details come
+// from the generator rather than the parser.
+bool FindLegalMove(Board& board, const std::string& text, Move& outMove) {
+    for (const Move& move : GenerateLegalMoves(board)) {
+        if (move.ToUci() == text) {
+            outMove = move;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string FormatScore(int score) {
+    int mate = MateInMoves(score);
+    return mate != 0 ? "mate " + std::to_string(mate) : "cp " + std::to_string(score);
+}
+
+class UciSession {
+public:
+    explicit UciSession(std::ostream& out)
+        : out_(out), search_(std::make_unique<SearchContext>(TTEntriesForMegabytes(kDefaultHashMb))) {
+        board_.LoadFen(kStartFen);
+    }
+
+    ~UciSession() { StopSearch(); }
+
+    // Returns false on "quit".
+    bool Handle(const std::string& line) {
+        std::istringstream args(line);
+        std::string command;
+        if (!(args >> command)) {
+            return true;
+        }
+        if (command == "uci") {
+            Identify();
+        } else if (command == "isready") {
+            Send("readyok");
+        } else if (command == "ucinewgame") {
+            StopSearch();
+            search_->Clear();
+        } else if (command == "setoption") {
+            StopSearch();
+            SetOption(args);
+        } else if (command == "position") {
+            StopSearch();
+            Position(args);
+        } else if (command == "go") {
+            StopSearch();
+            Go(args);
+        } else if (command == "stop") {
+            StopSearch();
+        } else if (command == "ponderhit") {
+            PonderHit();
+        } else if (command == "quit") {
+            return false;
+        }
+        return true;
+    }
+
+    void Identify() {
+        Send("id name ChessEngine");
+        Send("id author ChessEngine developers");
+        Send("option name Hash type spin default " + std::to_string(kDefaultHashMb) + " min 1 max " +
+             std::to_string(kMaxHashMb));
+        // A SearchContext is single-threaded; the option is accepted so GUIs can set it.
+        Send("option name Threads type spin default 1 min 1 max 1");
+        Send("option name Ponder type check default false");
+        Send("option name MultiPV type spin default 1 min 1 max " + std::to_string(kMaxMultiPv));
+        Send("option name OwnBook type check default false");
+        Send("option name BookFile type string default <empty>");
+        Send("uciok");
+    }
+
+    // At the end of input a search with a depth, node or time limit is allowed to finish, so
+    // scripted input gets a complete answer; infinite and ponder searches are stopped.
+    void FinishSearch() {
+        if (!worker_.joinable()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        bool holding = holding_;
+        lock.unlock();
+        if (holding) {
+            StopSearch();
+        } else {
+            worker_.join();
+        }
+    }
+
+private:
+    void Send(const std::string& text) {
+        std::lock_guard<std::mutex> lock(out_mutex_);
+        out_ << text << '\n';
+        out_.flush();
+    }
+
+    void SetOption(std::istringstream& args) {
+        std::string token;
+        std::string name;
+        std::string value;
+        args >> token;
+        while (args >> token && token != "value") {
+            name += name.empty() ? token : " " + token;
+        }
+        // String values (book paths) may contain spaces.
+        std::getline(args >> std::ws, value);
+        if (name == "Hash") {
+            int megabytes = 0;
+            std::istringstream(value) >> megabytes;
+            megabytes = std::clamp(megabytes, 1, kMaxHashMb);
+            search_ = std::make_unique<SearchContext>(TTEntriesForMegabytes(megabytes));
+        } else if (name == "MultiPV") {
+            int lines = 1;
+            std::istringstream(value) >> lines;
+            multi_pv_ = std::clamp(lines, 1, kMaxMultiPv);
+        } else if (name == "OwnBook") {
+            own_book_ = value == "true";
+        } else if (name == "BookFile") {
+            if (value.empty() || value == "<empty>") {
+                book_.Close();
+            } else if (!book_.Open(value)) {
+                Send("info string cannot open book " + value);
+            }
+        }
+    }
+
+    void Position(std::istringstream& args) {
+        std::string token;
+        args >> token;
+        if (token == "startpos") {
+            board_.LoadFen(kStartFen);
+            args >> token;
+        } else if (token == "fen") {
+            std::string fen;
+            while (args >> token && token != "moves") {
+                fen += fen.empty() ? token : " " + token;
+            }
+            if (!board_.LoadFen(fen)) {
+                board_.LoadFen(kStartFen);
+                return;
+            }
+        } else {
+            return;
+        }
+        if (token != "moves") {
+            return;
+        }
+        while (args >> token) {
+            Move move;
+            if (!FindLegalMove(board_, token, move)) {
+                return;
+            }
+            MoveUndo undo = ApplyMove(board_, move);
+            board_.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+        }
+    }
+
+    void Go(std::istringstream& args) {
+        auto start = std::chrono::steady_clock::now();
+        TimeControl clock;
+        bool has_clock = false;
+        long long move_time = 0;
+        bool infinite = false;
+        bool ponder = false;
+        SearchLimits limits;
+        limits.multiPv = multi_pv_;
+        std::string token;
+        while (args >> token) {
+            long long value = 0;
+            if (token == "infinite") {
+                infinite = true;
+            } else if (token == "ponder") {
+                ponder = true;
+            } else if (!(args >> value)) {
+                break;
+            } else if (token == (board_.SideToMove() == 'w' ? "wtime" : "btime")) {
+                clock.remaining = std::chrono::milliseconds(std::max(value, 0LL));
+                has_clock = true;
+            } else if (token == (board_.SideToMove() == 'w' ? "winc" : "binc")) {
+                clock.increment = std::chrono::milliseconds(std::max(value, 0LL));
+            } else if (token == "movestogo") {
+                clock.movesToGo = static_cast<int>(std::max(value, 0LL));
+            } else if (token == "depth") {
+                limits.maxDepth = static_cast<int>(std::clamp(value, 1LL, static_cast<long long>(kMaxSearchDepth)));
+            } else if (token == "nodes") {
+                limits.maxNodes = static_cast<uint64_t>(std::max(value, 1LL));
+            } else if (token == "movetime") {
+                move_time = std::max(value, 1LL);
+            }
+        }
+
+        if (!infinite) {
+            if (move_time > 0) {
+                limits.hardDeadline = start + std::chrono::milliseconds(move_time);
+            } else if (has_clock) {
+                TimeBudget budget = AllocateTime(clock);
+                limits.softDeadline = start + budget.soft;
+                limits.hardDeadline = start + budget.hard;
+            }
+        }
+        // A book move is answered at once, except in infinite and ponder mode where the GUI
+        // expects a search it can stop.
+        Move book_move;
+        if (own_book_ && book_.IsOpen() && !infinite && !ponder && book_.PickMove(board_, book_rng_, book_move)) {
+            Send("info string book move");
+            Send("bestmove " + book_move.ToUci());
+            return;
+        }
+
+        limits.onIteration = [this, start](int /*score*/, const SearchStats& stats) {
+            auto elapsed =
+                std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            uint64_t nodes = stats.nodes + stats.qnodes;
+            uint64_t nps = nodes * 1000 / static_cast<uint64_t>(std::max<long long>(elapsed.count(), 1));
+            int hashfull = search_->tt().Hashfull();
+            // One line per MultiPV line; the "multipv" field only appears when several are wanted.
+            for (size_t i = 0; i < stats.lines.size(); ++i) {
+                const PvLine& line = stats.lines[i];
+                std::ostringstream info;
+                info << "info depth " << stats.depth << " seldepth " << stats.seldepth;
+                if (stats.lines.size() > 1) {
+                    info << " multipv " << i + 1;
+                }
+                info << " score " << FormatScore(line.score) << " nodes " << nodes << " nps " << nps << " hashfull "
+                     << hashfull << " tbhits " << stats.tbhits << " time " << elapsed.count() << " pv";
+                for (const Move& move : line.pv) {
+                    info << ' ' << move.ToUci();
+                }
+                Send(info.str());
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            holding_ = infinite || ponder;
+            search_done_ = false;
+        }
+        if (ponder) {
+            search_->StartPondering();
+        }
+        worker_ = std::thread([this, board = board_, limits]() mutable { Search(board, limits); });
+    }
+
+    // Runs on the worker thread. UCI forbids "bestmove" before "stop" or "ponderhit" in
+    // infinite and ponder mode, so a search that finishes early waits for the release.
+    void Search(Board& board, const SearchLimits& limits) {
+        Move best;
+        int depth = 0;
+        uint64_t nodes = 0;
+        uint64_t qnodes = 0;
+        search_->SearchBestMoveTimed(board, limits, best, depth, nodes, qnodes);
+        std::vector<Move> legal = GenerateLegalMoves(board);
+        if (depth == 0 && !legal.empty()) {
+            best = legal.front();
+        }
+        const MoveList& pv = search_->LastStats().pv;
+        std::string ponder_text;
+        if (depth > 0 && pv.size() >= 2 && pv[0] == best) {
+            ponder_text = " ponder " + pv[1].ToUci();
+        }
+        if (kSearchStatsEnabled) {
+            std::ostringstream report;
+            PrintSearchInstrumentation(search_->LastInstrumentation(), report, "info string ");
+            std::string text = report.str();
+            text.pop_back();
+            Send(text);
+        }
+
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        search_done_ = true;
+        state_changed_.notify_all();
+        state_changed_.wait(lock, [this] { return !holding_; });
+        lock.unlock();
+        Send(legal.empty() ? std::string("bestmove 0000") : "bestmove " + best.ToUci() + ponder_text);
+    }
+
+    void PonderHit() {
+        search_->PonderHit();
+        std::lock_guard<std::mutex> lock(state_mutex_);
+        holding_ = false;
+        state_changed_.notify_all();
+    }
+
+    // Ends the running search, if any, once its bestmove has been sent. Stop() is repeated
+    // until the search returns because a search that has not started yet clears the flag.
+    void StopSearch() {
+        if (!worker_.joinable()) {
+            return;
+        }
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        holding_ = false;
+        state_changed_.notify_all();
+        while (!search_done_) {
+            search_->Stop();
+            state_changed_.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        lock.unlock();
+        worker_.join();
+    }
+
+    std::ostream& out_;
+    std::mutex out_mutex_;
+    std::unique_ptr<SearchContext> search_;
+    int multi_pv_ = 1;
+    bool own_book_ = false;
+    PolyglotBook book_;
+    std::mt19937_64 book_rng_{std::random_device{}()};
+    Board board_;
+    std::thread worker_;
+    std::mutex state_mutex_;
+    std::condition_variable state_changed_;
+    bool holding_ = false;
+    bool search_done_ = true;
+};
+}  // namespace
+
+int RunUci(std::istream& in, std::ostream& out, bool handshakeReceived) {
+    UciSession session(out);
+    if (handshakeReceived) {
+        session.Identify();
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!session.Handle(line)) {
+            return 0;
+        }
+    }
+    session.FinishSearch();
+    return 0;
+}
@@ -1,22 +1,370 @@
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <sstream>
 #include <string>
+#include <thread>
 
 #ifdef _WIN32
 #include <windows.h>
 #endif
 
+#include "BatchAnalysis.h"
+#include "Bench.h"
+#include "BookBuilder.h"
 #include "Board.h"
 #include "ConsoleRenderer.h"
 #include "MoveGen.h"
 #include "OpeningBook.h"
+#include "PerftSuite.h"
+#include "PolyglotBook.h"
+#include "San.h"
 #include "Search.h"
+#include "SelfPlay.h"
+#include "TimeManager.h"
+#include "Uci.h"
 
-int main() {
+namespace {
+// Searches the position after the human's expected reply while the console waits for input.
+// On a ponder hit the search keeps running on the AI's clock; on a miss it is stopped, and
+// the real search still benefits from the transposition table it warmed.
+class ConsolePonder {
+public:
+    explicit ConsolePonder(SearchContext& search) : search_(search) {}
+    ~ConsolePonder() { Cancel(); }
+
+    bool Active() const { return worker_.joinable(); }
+    const Move& ExpectedMove() const { return expected_; }
+
+    void Start(const Board& board, const Move& expected, const TimeControl& clock) {
+        board_ = board;
+        MoveUndo undo = ApplyMove(board_, expected);
+        board_.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+        expected_ = expected;
+        hit_ = false;
+        done_ = false;
+        // The budget is re-anchored at the ponder hit, so "now" only fixes its length.
+        auto now = std::chrono::steady_clock::now();
+        TimeBudget budget = AllocateTime(clock);
+        SearchLimits limits;
+        limits.softDeadline = now + budget.soft;
+        limits.hardDeadline = now + budget.hard;
+        search_.StartPondering();
+        worker_ = std::thread([this, limits] {
+            score_ = search_.SearchBestMoveTimed(board_, limits, best_, depth_, nodes_, qnodes_);
+            done_ = true;
+        });
+    }
+
+    void Hit() {
+        hit_start_ = std::chrono::steady_clock::now();
+        hit_ = true;
+        search_.PonderHit();
+    }
+
+    // Stops pondering. Stop() is repeated until the search returns because a search that
+    // has not started yet clears the flag.
+    void Cancel() {
+        if (!Active()) {
+            return;
+        }
+        while (!done_) {
+            search_.Stop();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        worker_.join();
+        hit_ = false;
+    }
+
+    // After a hit, waits for the search to finish and returns its result; the time spent
+    // counts from the hit.
+    bool Finish(Move& best, int& depth, uint64_t& nodes, uint64_t& qnodes, int& score,
+                std::chrono::milliseconds& spent) {
+        if (!Active() || !hit_) {
+            return false;
+        }
+        worker_.join();
+        hit_ = false;
+        if (depth_ == 0) {
+            return false;
+        }
+        best = best_;
+        depth = depth_;
+        nodes = nodes_;
+        qnodes = qnodes_;
+        score = score_;
+        spent = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - hit_start_);
+        return true;
+    }
+
+private:
+    SearchContext& search_;
+    std::thread worker_;
+    std::atomic<bool> done_{true};
+    Board board_;
+    Move expected_;
+    bool hit_ = false;
+    std::chrono::steady_clock::time_point hit_start_;
+    Move best_;
+    int depth_ = 0;
+    uint64_t nodes_ = 0;
+    uint64_t qnodes_ = 0;
+    int score_ = 0;
+};
+
+// The reply the AI expects: the second move of its principal variation, otherwise the
+// transposition table's move for the current position.
+bool ExpectedReply(SearchContext& search, Board& board, const Move& played, Move& outMove) {
+    const MoveList& pv = search.LastStats().pv;
+    Move candidate;
+    if (pv.size() >= 2 && pv[0] == played) {
+        candidate = pv[1];
+    } else if (!search.tt().PeekBestMove(board.Hash(), candidate)) {
+        return false;
+    }
+    for (const Move& move : GenerateLegalMoves(board)) {
+        if (move == candidate) {
+            outMove = move;
+            return true;
+        }
+    }
+    return false;
+}
+
+// chessengine analyze <file|-> [--threads N] [--depth D] [--nodes N] [--movetime MS]
+//                     [--hash MB] [--format csv|jsonl] [--output FILE]
+int RunAnalyzeCommand(int argc, char* argv[]) {
+    AnalysisOptions options;
+    options.threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    bool depth_given = false;
+    std::string output_path;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") {
+            options.threads = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--depth") {
+            options.depth = std::atoi(value.c_str());
+            depth_given = true;
+        } else if (arg == "--nodes") {
+            options.nodes = std::strtoull(value.c_str(), nullptr, 10);
+        } else if (arg == "--movetime") {
+            options.moveTime = std::chrono::milliseconds(std::atoi(value.c_str()));
+        } else if (arg == "--hash") {
+            options.hashMb = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--format" && (value == "csv" || value == "jsonl")) {
+            options.format = value == "csv" ? AnalysisFormat::Csv : AnalysisFormat::Jsonl;
+        } else if (arg == "--output") {
+            output_path = value;
+        } else {
+            std::cerr << "Unknown option " << arg << ' ' << value << '\n';
+            return 1;
+        }
+    }
+    // A node or time limit alone replaces the default depth.
+    if (!depth_given && (options.nodes > 0 || options.moveTime.count() > 0)) {
+        options.depth = kMaxSearchDepth;
+    }
+
+    std::string input_path = argv[2];
+    std::ifstream input_file;
+    if (input_path != "-") {
+        input_file.open(input_path);
+        if (!input_file) {
+            std::cerr << "Cannot open " << input_path << '\n';
+            return 1;
+        }
+    }
+    std::ofstream output_file;
+    if (!output_path.empty()) {
+        output_file.open(output_path);
+        if (!output_file) {
+            std::cerr << "Cannot write " << output_path << '\n';
+            return 1;
+        }
+    }
+    std::istream& in = input_path == "-" ? std::cin : input_file;
+    std::ostream& out = output_path.empty() ? std::cout : output_file;
+    AnalysisSummary summary = RunBatchAnalysis(in, options, out, std::cerr);
+    return summary.invalid == 0 ? 0 : 1;
+}
+
+// chessengine match <openings> [--games N] [--concurrency N] [--engine1 SPEC] [--engine2 SPEC]
+//                   [--max-plies N] [--elo0 E] [--elo1 E] [--alpha A] [--beta B] [--no-sprt]
+// SPEC is "key=value,..." as accepted by ParseEngineConfig. Exits with 1 when the SPRT
+// accepts H0 (engine1 is not elo1 stronger than engine2).
+int RunMatchCommand(int argc, char* argv[]) {
+    MatchOptions options;
+    EngineConfig first;
+    EngineConfig second;
+    first.name = "engine1";
+    second.name = "engine2";
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--no-sprt") {
+            options.sprt.enabled = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--games") {
+            options.games = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--concurrency") {
+            options.concurrency = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--engine1") {
+            ok = ParseEngineConfig(value, first);
+        } else if (arg == "--engine2") {
+            ok = ParseEngineConfig(value, second);
+        } else if (arg == "--max-plies") {
+            options.maxPlies = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--elo0") {
+            options.sprt.elo0 = std::atof(value.c_str());
+        } else if (arg == "--elo1") {
+            options.sprt.elo1 = std::atof(value.c_str());
+        } else if (arg == "--alpha") {
+            options.sprt.alpha = std::atof(value.c_str());
+        } else if (arg == "--beta") {
+            options.sprt.beta = std::atof(value.c_str());
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << "Invalid option " << arg << ' ' << value << '\n';
+            return 1;
+        }
+    }
+
+    std::ifstream file(argv[2]);
+    if (!file) {
+        std::cerr << "Cannot open " << argv[2] << '\n';
+        return 1;
+    }
+    std::vector<std::string> openings;
+    std::string line;
+    while (std::getline(file, line)) {
+        std::string fen;
+        if (line.find_first_not_of(" \t\r") == std::string::npos || line[0] == '#') {
+            continue;
+        }
+        if (!NormalizeFen(line, fen)) {
+            std::cerr << "Skipping invalid opening: " << line << '\n';
+            continue;
+        }
+        openings.push_back(fen);
+    }
+    if (openings.empty()) {
+        std::cerr << "No openings in " << argv[2] << '\n';
+        return 1;
+    }
+
+    MatchResult result = RunMatch(openings, first, second, options, std::cout);
+    std::cout << first.name << " vs " << second.name << ": +" << result.wins << " -" << result.losses << " ="
+              << result.draws << " in " << result.games << " games, elo " << result.elo << " +/- "
+              << result.eloMargin << '\n';
+    if (options.sprt.enabled) {
+        std::cout << "SPRT elo0 " << options.sprt.elo0 << " elo1 " << options.sprt.elo1 << ": llr " << result.llr
+                  << " [" << result.lowerBound << ", " << result.upperBound << "], "
+                  << (result.decision == SprtDecision::AcceptH1   ? "H1 accepted"
+                      : result.decision == SprtDecision::AcceptH0 ? "H0 accepted"
+                                                                  : "inconclusive")
+                  << '\n';
+    }
+    return result.decision == SprtDecision::AcceptH0 ? 1 : 0;
+}
+
+// chessengine makebook <games.pgn|-> <book.bin> [--threads N] [--max-ply N] [--min-games N]
+int RunMakeBookCommand(int argc, char* argv[]) {
+    BookBuildOptions options;
+    options.threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << '\n';
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--threads") {
+            options.threads = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--max-ply") {
+            options.maxPly = std::max(std::atoi(value.c_str()), 1);
+        } else if (arg == "--min-games") {
+            options.minGames = std::max(std::atoi(value.c_str()), 1);
+        } else {
+            std::cerr << "Unknown option " << arg << ' ' << value << '\n';
+            return 1;
+        }
+    }
+
+    std::string input_path = argv[2];
+    std::ifstream input_file;
+    if (input_path != "-") {
+        input_file.open(input_path);
+        if (!input_file) {
+            std::cerr << "Cannot open " << input_path << '\n';
+            return 1;
+        }
+    }
+    std::ofstream output_file(argv[3], std::ios::binary);
+    if (!output_file) {
+        std::cerr << "Cannot write " << argv[3] << '\n';
+        return 1;
+    }
+    BookBuildSummary summary = BuildBook(input_path == "-" ? std::cin : input_file, options, output_file, std::cerr);
+    return summary.games > 0 ? 0 : 1;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
 #ifdef _WIN32
     SetConsoleOutputCP(CP_UTF8);
     SetConsoleCP(CP_UTF8);
 #endif
+    if (argc > 1 && std::string(argv[1]) == "uci") {
+        return RunUci(std::cin, std::cout);
+    }
+    if (argc > 2 && std::string(argv[1]) == "perft") {
+        std::ifstream epd(argv[2]);
+        if (!epd) {
+            std::cerr << "Cannot open " << argv[2] << '\n';
+            return 1;
+        }
+        PerftSuiteOptions options;
+        if (argc > 3) {
+            options.maxDepth = std::atoi(argv[3]);
+        }
+        if (argc > 4) {
+            options.timeCap = std::chrono::milliseconds(std::atoi(argv[4]));
+        }
+        PerftSuiteResult result = RunPerftSuite(epd, options, std::cout);
+        return result.failed == 0 && result.invalid == 0 && result.positions > 0 ? 0 : 1;
+    }
+    if (argc > 2 && std::string(argv[1]) == "analyze") {
+        return RunAnalyzeCommand(argc, argv);
+    }
+    if (argc > 2 && std::string(argv[1]) == "match") {
+        return RunMatchCommand(argc, argv);
+    }
+    if (argc > 3 && std::string(argv[1]) == "makebook") {
+        return RunMakeBookCommand(argc, argv);
+    }
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        int depth = argc > 2 ? std::atoi(argv[2]) : kDefaultBenchDepth;
+        RunBench(depth > 0 ? depth : kDefaultBenchDepth, std::cout);
+        return 0;
+    }
+
     const std::string start_fen =
         "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
 
@@ -26,10 +374,20 @@ int main() {
         return 1;
     }
 
+    SearchContext search;
+    ConsolePonder ponder(search);
+    bool ponder_enabled = true;
     int ply_count = 0;
     const int max_book_plies = 6;
     bool book_enabled = true;
+    // A Polyglot book loaded with "book <file.bin>" replaces the built-in lines.
+    PolyglotBook polyglot_book;
+    std::mt19937_64 book_rng(std::random_device{}());
     bool expert_mode = false;
+    // The AI plays on a clock (default 2 minutes + 1 second per move); the human does not.
+    TimeControl engine_clock;
+    engine_clock.remaining = std::chrono::minutes(2);
+    engine_clock.increment = std::chrono::seconds(1);
 
     while (true) {
         auto legal_moves = GenerateLegalMoves(board);
@@ -43,6 +401,14 @@ int main() {
             }
             break;
         }
+        if (board.IsRepetition(2)) {
+            std::cout << "Draw by threefold repetition.\n";
+            break;
+        }
+        if (board.IsFiftyMoveDraw()) {
+            std::cout << "Draw by fifty-move rule.\n";
+            break;
+        }
 
         RenderBoard(board, true);
 
@@ -56,6 +422,11 @@ int main() {
                 if (input == "quit") {
                     return 0;
                 }
+                // GUIs start the engine without arguments and open with "uci".
+                if (input == "uci") {
+                    ponder.Cancel();
+                    return RunUci(std::cin, std::cout, true);
+                }
                 if (input == "moves") {
                     for (const auto& move : legal_moves) {
                         std::cout << move.ToUci() << ' ';
@@ -73,33 +444,74 @@ int main() {
                     std::cout << "Opening book disabled.\n";
                     continue;
                 }
+                if (input.rfind("book ", 0) == 0) {
+                    std::string path = input.substr(5);
+                    if (polyglot_book.Open(path)) {
+                        book_enabled = true;
+                        std::cout << "Loaded " << polyglot_book.Entries() << " book entries.\n";
+                    } else {
+                        std::cout << "Cannot open book " << path << '\n';
+                    }
+                    continue;
+                }
+                if (input.rfind("clock ", 0) == 0) {
+                    std::istringstream args(input.substr(6));
+                    double minutes = 0.0;
+                    double increment_seconds = 0.0;
+                    if (!(args >> minutes >> increment_seconds) || minutes <= 0.0 || increment_seconds < 0.0) {
+                        std::cout << "Usage: clock <minutes> <increment seconds>\n";
+                        continue;
+                    }
+                    engine_clock.remaining =
+                        std::chrono::milliseconds(static_cast<long long>(minutes * 60000.0));
+                    engine_clock.increment =
+                        std::chrono::milliseconds(static_cast<long long>(increment_seconds * 1000.0));
+                    std::cout << "AI clock set.\n";
+                    continue;
+                }
+                if (input == "ponder on" || input == "ponder off") {
+                    ponder_enabled = input == "ponder on";
+                    if (!ponder_enabled) {
+                        ponder.Cancel();
+                    }
+                    std::cout << (ponder_enabled ? "Pondering enabled.\n" : "Pondering disabled.\n");
+                    continue;
+                }
                 if (input == "expert") {
                     expert_mode = !expert_mode;
                     std::cout << (expert_mode ? "Expert mode enabled.\n" : "Expert mode disabled.\n");
                     continue;
                 }
 
-                auto parsed = Move::ParseUci(input);
-                if (!parsed.has_value()) {
-                    std::cout << "Illegal move\n";
-                    continue;
-                }
-
+                // Coordinates ("g1f3") or SAN ("Nf3").
                 bool found = false;
-                Move chosen = *parsed;
+                Move chosen;
+                auto parsed = Move::ParseUci(input);
                 for (const auto& move : legal_moves) {
-                    if (move.ToUci() == chosen.ToUci()) {
+                    if (parsed.has_value() && move.ToUci() == parsed->ToUci()) {
                         chosen = move;
                         found = true;
                         break;
                     }
                 }
+                if (!found) {
+                    auto san = ParseSan(board, input);
+                    if (san.has_value()) {
+                        chosen = *san;
+                        found = true;
+                    }
+                }
 
                 if (!found) {
                     std::cout << "Illegal move\n";
                     continue;
                 }
 
+                if (ponder.Active() && chosen == ponder.ExpectedMove()) {
+                    ponder.Hit();
+                } else {
+                    ponder.Cancel();
+                }
                 MoveUndo undo = ApplyMove(board, chosen);
                 board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
                 ply_count += 1;
@@ -107,20 +519,57 @@ int main() {
             }
         } else {
             Move best(0, 0);
-            if (book_enabled && !expert_mode && GetBookMove(board, legal_moves, ply_count, max_book_plies, best)) {
+            bool searched = false;
+            bool book_move = false;
+            if (book_enabled && !expert_mode) {
+                book_move = polyglot_book.IsOpen()
+                    ? polyglot_book.PickMove(board, book_rng, best)
+                    : GetBookMove(board, legal_moves, ply_count, max_book_plies, best);
+            }
+            if (book_move) {
+                ponder.Cancel();
                 std::cout << "AI plays (book): " << best.ToUci() << '\n';
             } else {
                 int depth_reached = 0;
                 uint64_t nodes = 0;
                 uint64_t qnodes = 0;
-                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
-                int score = SearchBestMoveTimed(board, 3, deadline, best, depth_reached, nodes, qnodes);
-                std::cout << "AI plays: " << best.ToUci() << " (depth " << depth_reached
-                          << ", score " << score << ", nodes " << nodes << ", qnodes " << qnodes << ")\n";
+                int score = 0;
+                std::chrono::milliseconds spent{0};
+                bool ponder_hit = ponder.Finish(best, depth_reached, nodes, qnodes, score, spent);
+                if (!ponder_hit) {
+                    auto start = std::chrono::steady_clock::now();
+                    TimeBudget budget = AllocateTime(engine_clock);
+                    SearchLimits limits;
+                    limits.softDeadline = start + budget.soft;
+                    limits.hardDeadline = start + budget.hard;
+                    score = search.SearchBestMoveTimed(board, limits, best, depth_reached, nodes, qnodes);
+                    spent = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        std::chrono::steady_clock::now() - start);
+                }
+                searched = true;
+                engine_clock.remaining = std::max(engine_clock.remaining - spent, std::chrono::milliseconds(0)) +
+                                         engine_clock.increment;
+                std::cout << "AI plays: " << best.ToUci() << (ponder_hit ? " (ponder hit, depth " : " (depth ") << depth_reached << "/"
+                          << search.LastStats().seldepth << ", score " << score << ", nodes " << nodes
+                          << ", qnodes " << qnodes << ", time " << spent.count() << "ms, clock "
+                          << engine_clock.remaining.count() / 1000 << "s)\n";
+                std::cout << "PV:";
+                for (const Move& move : search.LastStats().pv) {
+                    std::cout << ' ' << move.ToUci();
+                }
+                std::cout << '\n';
+                if (kSearchStatsEnabled) {
+                    PrintSearchInstrumentation(search.LastInstrumentation(), std::cout, "  ");
+                }
             }
             MoveUndo undo = ApplyMove(board, best);
             board.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
             ply_count += 1;
+
+            Move expected;
+            if (ponder_enabled && searched && ExpectedReply(search, board, best, expected)) {
+                ponder.Start(board, expected, engine_clock);
+            }
         }
     }
 
@@ -1,14 +1,56 @@
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
 #include <set>
 #include <sstream>
+#include <thread>
 #include <vector>
 
+#include "BatchAnalysis.h"
+#include "Bench.h"
 #include "Board.h"
+#include "BookBuilder.h"
 #include "MoveGen.h"
+#include "MoveOrdering.h"
+#include "PerftSuite.h"
+#include "PolyglotBook.h"
+#include "Pgn.h"
 #include "Move.h"
+#include "San.h"
 #include "Search.h"
+#include "SelfPlay.h"
+#include "Tablebase.h"
+#include "TimeManager.h"
 #include "TranspositionTable.h"
+#include "Uci.h"
+
+namespace {
+// Counts global heap allocations so tests can assert that hot paths never allocate.
+std::atomic<std::size_t> g_allocation_count{0};
+}  // namespace
+
+void* operator new(std::size_t size) {
+    g_allocation_count += 1;
+    if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
 
 int main() {
     auto move = Move::ParseUci("e2e4");
@@ -25,6 +67,9 @@ int main() {
     auto promo = Move::ParseUci("e7e8q");
     assert(promo.has_value());
     assert(promo->ToUci() == "e7e8q");
+    assert(*promo == Move::ParseUci("e7e8q").value());
+    assert(*promo != Move::ParseUci("e7e8n").value());
+    assert(Move() == Move(0, 0));
 
     assert(!SquareFromString("e9").has_value());
     assert(!SquareFromString("i2").has_value());
@@ -341,6 +386,737 @@ int main() {
     assert(bishop_developed_board.LoadFen(bishop_developed_fen));
     assert(EvaluateMaterial(bishop_developed_board) > EvaluateMaterial(bishop_undeveloped_board));
 
+    const std::string mate_in_one_fen = "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1";
+    Board mate_in_one_board;
+    assert(mate_in_one_board.LoadFen(mate_in_one_fen));
+    Move mate_move(0, 0);
+    int mate_depth = 0;
+    uint64_t mate_nodes = 0;
+    uint64_t mate_qnodes = 0;
+    int mate_score = SearchBestMoveTimed(mate_in_one_board,
+                                         4,
+                                         std::chrono::steady_clock::now() + std::chrono::seconds(30),
+                                         mate_move,
+                                         mate_depth,
+                                         mate_nodes,
+                                         mate_qnodes);
+    assert(mate_depth == 4);
+    assert(mate_move.ToUci() == "a1a8");
+    assert(mate_score > 99000);
+
+    // Aspiration windows and principal variation search find what one full-window search of
+    // the same depth finds. The knight fork scores 270 at depth 2 and 0 at depth 3, so the
+    // window around 270 fails low and is re-searched; in the middlegame the narrow windows
+    // and the move ordering of earlier iterations save most of the nodes.
+    auto compare_full_window = [](const std::string& fen, int depth, std::vector<int>& iteration_scores) {
+        Board b;
+        assert(b.LoadFen(fen));
+        SearchContext windowed(1 << 16);
+        SearchLimits limits;
+        limits.maxDepth = depth;
+        limits.onIteration = [&iteration_scores](int score, const SearchStats&) { iteration_scores.push_back(score); };
+        Move windowed_move(0, 0);
+        int windowed_depth = 0;
+        uint64_t windowed_nodes = 0;
+        uint64_t windowed_qnodes = 0;
+        int windowed_score =
+            windowed.SearchBestMoveTimed(b, limits, windowed_move, windowed_depth, windowed_nodes, windowed_qnodes);
+        SearchContext full(1 << 16);
+        Move full_move(0, 0);
+        int full_score = full.SearchBestMove(b, depth, full_move);
+        assert(windowed_depth == depth && windowed_move == full_move && windowed_score == full_score);
+        return static_cast<double>(windowed_nodes + windowed_qnodes) /
+            static_cast<double>(full.LastStats().nodes + full.LastStats().qnodes);
+    };
+    std::vector<int> fork_scores;
+    compare_full_window("r3k3/8/8/1N6/8/8/8/4K3 w - - 0 1", 6, fork_scores);
+    assert(fork_scores.size() == 6 && fork_scores[1] - fork_scores[2] > 50);
+    std::vector<int> middlegame_scores;
+    assert(compare_full_window("5rk1/1ppb3p/p1pb4/6q1/3P1p1r/2P1R2P/PP1BQ1P1/5RKN w - - 0 1", 6, middlegame_scores) < 0.5);
+
+    // Late move reductions: the mate in three starts with a quiet king move, and below it
+    // the defender's late quiet replies are searched at reduced depth. Only the full-depth
+    // re-search of a reduced reply that beats alpha still finds the mate at depth 6.
+    SearchContext lmr_context(1 << 16);
+    Board lmr_board;
+    assert(lmr_board.LoadFen("R7/8/8/6p1/6P1/4K3/7k/8 w - - 0 1"));
+    Move lmr_move(0, 0);
+    int lmr_score = lmr_context.SearchBestMove(lmr_board, 6, lmr_move);
+    assert(lmr_move.ToUci() == "e3f3" && MateInMoves(lmr_score) == 3);
+
+    // Quiet move ordering: killers, then the counter move to the previous move, then history.
+    auto ordering = std::make_unique<SearchHeuristics>();
+    KillerMoves killers{};
+    const Move knight_out = Move::ParseUci("g1f3").value();
+    const Move bishop_out = Move::ParseUci("f1c4").value();
+    const Move pawn_push = Move::ParseUci("h2h3").value();
+    const Move reply_to = Move::ParseUci("e7e5").value();
+    for (int i = 0; i < 3; ++i) {
+        RecordQuietCutoff(*ordering, killers, Move(), 0, 8, pawn_push);
+    }
+    RecordQuietCutoff(*ordering, killers, reply_to, 0, 2, knight_out);
+    assert(killers[0] == knight_out && killers[1] == pawn_push);
+    assert(QuietMoveScore(*ordering, killers, reply_to, 0, knight_out) >
+           QuietMoveScore(*ordering, killers, reply_to, 0, pawn_push));
+    KillerMoves no_killers{};
+    int counter_score = QuietMoveScore(*ordering, no_killers, reply_to, 0, knight_out);
+    assert(counter_score > QuietMoveScore(*ordering, no_killers, reply_to, 0, pawn_push));
+    assert(QuietMoveScore(*ordering, no_killers, Move::ParseUci("c7c5").value(), 0, knight_out) <
+           QuietMoveScore(*ordering, no_killers, Move::ParseUci("c7c5").value(), 0, pawn_push));
+    assert(QuietMoveScore(*ordering, no_killers, Move(), 1, pawn_push) == 0);
+    PenalizeQuietMove(*ordering, 0, 8, bishop_out);
+    assert(QuietMoveScore(*ordering, no_killers, Move(), 0, bishop_out) < 0);
+    // Gravity keeps history bounded under repeated bonuses, and a penalty pulls it back.
+    int history_entry = 0;
+    for (int i = 0; i < 1000; ++i) {
+        UpdateHistory(history_entry, kHistoryMax / 4);
+    }
+    assert(history_entry > kHistoryMax / 2 && history_entry <= kHistoryMax);
+    int saturated = history_entry;
+    UpdateHistory(history_entry, -kHistoryMax / 4);
+    assert(history_entry < saturated - kHistoryMax / 4);
+
+    // The heuristics persist across searches: with the TT cleared, a repeated search orders
+    // better and needs fewer nodes; SearchContext::Clear() forgets them again.
+    SearchContext ordering_context(1 << 16);
+    auto ordering_nodes = [&]() {
+        Board b;
+        assert(b.LoadFen("r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4"));
+        Move m(0, 0);
+        ordering_context.SearchBestMove(b, 5, m);
+        return ordering_context.LastStats().nodes + ordering_context.LastStats().qnodes;
+    };
+    uint64_t cold_nodes = ordering_nodes();
+    ordering_context.tt().Clear();
+    assert(ordering_nodes() < cold_nodes);
+    ordering_context.Clear();
+    assert(ordering_nodes() == cold_nodes);
+
+    const std::string alloc_fen = "r1bqkb1r/pppp1ppp/2n2n2/4p3/2B1P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4";
+    Board alloc_board;
+    assert(alloc_board.LoadFen(alloc_fen));
+    Move alloc_move(0, 0);
+    int alloc_depth = 0;
+    uint64_t alloc_nodes = 0;
+    uint64_t alloc_qnodes = 0;
+    auto alloc_deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+    SearchBestMoveTimed(alloc_board, 3, alloc_deadline, alloc_move, alloc_depth, alloc_nodes, alloc_qnodes);
+    std::size_t allocations_before = g_allocation_count;
+    SearchBestMoveTimed(alloc_board, 4, alloc_deadline, alloc_move, alloc_depth, alloc_nodes, alloc_qnodes);
+    assert(g_allocation_count == allocations_before);
+    assert(alloc_depth == 4);
+    assert(alloc_nodes > 0);
+
+    struct ContextResult {
+        std::string move;
+        uint64_t nodes = 0;
+    };
+    auto search_fresh = [](const std::string& fen) {
+        SearchContext context(1 << 16);
+        Board b;
+        assert(b.LoadFen(fen));
+        Move m(0, 0);
+        int depth = 0;
+        uint64_t nodes = 0;
+        uint64_t qnodes = 0;
+        context.SearchBestMoveTimed(b, 4, std::chrono::steady_clock::time_point::max(), m, depth, nodes, qnodes);
+        assert(depth == 4);
+        assert(context.LastStats().nodes == nodes);
+        return ContextResult{m.ToUci(), nodes};
+    };
+    const std::string context_fen_a = start_fen;
+    const std::string context_fen_b = alloc_fen;
+    ContextResult serial_a = search_fresh(context_fen_a);
+    ContextResult serial_b = search_fresh(context_fen_b);
+    ContextResult parallel_a;
+    ContextResult parallel_b;
+    std::thread thread_a([&] { parallel_a = search_fresh(context_fen_a); });
+    std::thread thread_b([&] { parallel_b = search_fresh(context_fen_b); });
+    thread_a.join();
+    thread_b.join();
+    assert(parallel_a.move == serial_a.move && parallel_a.nodes == serial_a.nodes);
+    assert(parallel_b.move == serial_b.move && parallel_b.nodes == serial_b.nodes);
+
+    SearchContext stop_context(1 << 16);
+    Board stop_board;
+    assert(stop_board.LoadFen(alloc_fen));
+    uint64_t stop_hash = stop_board.Hash();
+    Move stop_move(0, 0);
+    int stop_depth = 0;
+    uint64_t stop_nodes = 0;
+    uint64_t stop_qnodes = 0;
+    std::thread stopper([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        stop_context.Stop();
+    });
+    auto stop_started = std::chrono::steady_clock::now();
+    stop_context.SearchBestMoveTimed(stop_board,
+                                     64,
+                                     std::chrono::steady_clock::time_point::max(),
+                                     stop_move,
+                                     stop_depth,
+                                     stop_nodes,
+                                     stop_qnodes);
+    stopper.join();
+    assert(std::chrono::steady_clock::now() - stop_started < std::chrono::seconds(10));
+    assert(stop_depth >= 1 && stop_depth < 64);
+    assert(stop_board.Hash() == stop_hash);
+    std::vector<Move> stop_legal = GenerateLegalMoves(stop_board);
+    assert(std::find(stop_legal.begin(), stop_legal.end(), stop_move) != stop_legal.end());
+
+    // Node-limited searches stop after exactly the limit and repeat exactly after Clear().
+    SearchContext node_context(1 << 16);
+    const uint64_t node_limit = 5000;
+    auto search_nodes = [&](std::string& outMove, int& outDepth) {
+        node_context.Clear();
+        Board b;
+        assert(b.LoadFen(alloc_fen));
+        SearchLimits limits;
+        limits.maxNodes = node_limit;
+        Move m(0, 0);
+        uint64_t nodes = 0;
+        uint64_t qnodes = 0;
+        node_context.SearchBestMoveTimed(b, limits, m, outDepth, nodes, qnodes);
+        outMove = m.ToUci();
+        return nodes + qnodes;
+    };
+    std::string node_move_a;
+    std::string node_move_b;
+    int node_depth_a = 0;
+    int node_depth_b = 0;
+    assert(search_nodes(node_move_a, node_depth_a) == node_limit);
+    assert(search_nodes(node_move_b, node_depth_b) == node_limit);
+    assert(node_move_a == node_move_b && node_depth_a == node_depth_b && node_depth_a >= 1);
+
+    SearchContext ponder_context(1 << 16);
+    Board ponder_board;
+    assert(ponder_board.LoadFen(alloc_fen));
+    SearchLimits ponder_limits;
+    ponder_limits.hardDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(20);
+    Move ponder_move(0, 0);
+    int ponder_depth = 0;
+    uint64_t ponder_nodes = 0;
+    uint64_t ponder_qnodes = 0;
+    ponder_context.StartPondering();
+    std::thread ponder_hitter([&] {
+        std::this_thread::sleep_for(std::chrono::milliseconds(150));
+        ponder_context.PonderHit();
+    });
+    auto ponder_started = std::chrono::steady_clock::now();
+    ponder_context.SearchBestMoveTimed(ponder_board, ponder_limits, ponder_move, ponder_depth, ponder_nodes, ponder_qnodes);
+    ponder_hitter.join();
+    assert(std::chrono::steady_clock::now() - ponder_started >= std::chrono::milliseconds(150));
+    assert(ponder_depth >= 1);
+
+    SearchContext root_context(1 << 16);
+    Board root_board;
+    assert(root_board.LoadFen("4k3/8/8/3q4/8/8/3R4/4K3 w - - 0 1"));
+    Move root_move(0, 0);
+    int root_depth = 0;
+    uint64_t root_nodes = 0;
+    uint64_t root_qnodes = 0;
+    root_context.SearchBestMoveTimed(root_board,
+                                     5,
+                                     std::chrono::steady_clock::time_point::max(),
+                                     root_move,
+                                     root_depth,
+                                     root_nodes,
+                                     root_qnodes);
+    assert(root_depth == 5);
+    assert(root_move.ToUci() == "d2d5");
+
+    const SearchInstrumentation& instrumentation = root_context.LastInstrumentation();
+    if (kSearchStatsEnabled) {
+        uint64_t qsearch_total = 0;
+        for (uint64_t count : instrumentation.qsearch_depth) {
+            qsearch_total += count;
+        }
+        assert(qsearch_total == root_qnodes);
+        assert(instrumentation.iteration_nodes[5] > 0);
+        assert(instrumentation.tt_probes > 0 && instrumentation.tt_hits <= instrumentation.tt_probes);
+        assert(instrumentation.first_move_cutoffs <= instrumentation.cutoffs);
+        assert(instrumentation.total_time >= instrumentation.movegen_time + instrumentation.eval_time);
+    } else {
+        assert(instrumentation.tt_probes == 0 && instrumentation.cutoffs == 0);
+    }
+
+    SearchContext pv_context(1 << 16);
+    Board pv_board;
+    assert(pv_board.LoadFen(alloc_fen));
+    Move pv_move(0, 0);
+    int pv_depth = 0;
+    uint64_t pv_nodes = 0;
+    uint64_t pv_qnodes = 0;
+    pv_context.SearchBestMoveTimed(pv_board,
+                                   5,
+                                   std::chrono::steady_clock::time_point::max(),
+                                   pv_move,
+                                   pv_depth,
+                                   pv_nodes,
+                                   pv_qnodes);
+    const SearchStats& pv_stats = pv_context.LastStats();
+    assert(pv_stats.pv.size() >= 2 && pv_stats.pv.size() <= pv_depth);
+    assert(pv_stats.pv[0] == pv_move);
+    assert(pv_stats.seldepth >= pv_stats.pv.size());
+    Board pv_line = pv_board;
+    for (const Move& move : pv_stats.pv) {
+        std::vector<Move> legal = GenerateLegalMoves(pv_line);
+        assert(std::find(legal.begin(), legal.end(), move) != legal.end());
+        MoveUndo undo = ApplyMove(pv_line, move);
+        pv_line.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+    }
+
+    TimeControl sudden_death;
+    sudden_death.remaining = std::chrono::seconds(60);
+    TimeBudget sudden_budget = AllocateTime(sudden_death);
+    assert(sudden_budget.soft > std::chrono::milliseconds(0));
+    assert(sudden_budget.soft <= sudden_budget.hard);
+    assert(sudden_budget.hard < sudden_death.remaining);
+    TimeControl with_increment = sudden_death;
+    with_increment.increment = std::chrono::seconds(2);
+    assert(AllocateTime(with_increment).soft > sudden_budget.soft);
+    TimeControl last_move = sudden_death;
+    last_move.movesToGo = 1;
+    assert(AllocateTime(last_move).soft > AllocateTime(with_increment).soft);
+    assert(AllocateTime(last_move).hard < last_move.remaining);
+    TimeControl flagging;
+    flagging.remaining = std::chrono::milliseconds(10);
+    assert(AllocateTime(flagging).soft >= std::chrono::milliseconds(1));
+    assert(SoftTimeScale(5, false) < SoftTimeScale(1, false));
+    assert(SoftTimeScale(0, false) > SoftTimeScale(1, false));
+    assert(SoftTimeScale(1, true) > SoftTimeScale(1, false));
+
+    SearchContext soft_context(1 << 16);
+    Board soft_board;
+    assert(soft_board.LoadFen(alloc_fen));
+    SearchLimits soft_limits;
+    auto soft_start = std::chrono::steady_clock::now();
+    soft_limits.softDeadline = soft_start + std::chrono::milliseconds(50);
+    soft_limits.hardDeadline = soft_start + std::chrono::seconds(20);
+    Move soft_move(0, 0);
+    int soft_depth = 0;
+    uint64_t soft_nodes = 0;
+    uint64_t soft_qnodes = 0;
+    soft_context.SearchBestMoveTimed(soft_board, soft_limits, soft_move, soft_depth, soft_nodes, soft_qnodes);
+    assert(soft_depth >= 1 && soft_depth < kMaxSearchDepth);
+    assert(std::chrono::steady_clock::now() < soft_limits.hardDeadline);
+
+    std::istringstream uci_in(
+        "uci\nisready\nsetoption name Hash value 1\nposition fen 6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1\ngo depth 4\n");
+    std::ostringstream uci_out;
+    assert(RunUci(uci_in, uci_out) == 0);
+    const std::string uci_text = uci_out.str();
+    assert(uci_text.find("uciok\n") != std::string::npos);
+    assert(uci_text.find("readyok\n") != std::string::npos);
+    assert(uci_text.find("info depth 4 ") != std::string::npos);
+    assert(uci_text.find("score mate 1") != std::string::npos);
+    assert(uci_text.find("bestmove a1a8\n") != std::string::npos);
+
+    std::istringstream uci_stop_in("position startpos moves e2e4 e7e5\ngo infinite\nstop\nisready\n");
+    std::ostringstream uci_stop_out;
+    assert(RunUci(uci_stop_in, uci_stop_out) == 0);
+    const std::string uci_stop_text = uci_stop_out.str();
+    size_t uci_bestmove = uci_stop_text.find("bestmove ");
+    assert(uci_bestmove != std::string::npos);
+    assert(uci_stop_text.find("readyok", uci_bestmove) != std::string::npos);
+    Board uci_board;
+    assert(uci_board.LoadFen("rnbqkbnr/pppp1ppp/8/4p3/4P3/8/PPPP1PPP/RNBQKBNR w KQkq - 0 2"));
+    auto uci_move = Move::ParseUci(uci_stop_text.substr(uci_bestmove + 9, 4));
+    assert(uci_move.has_value());
+    std::vector<Move> uci_legal = GenerateLegalMoves(uci_board);
+    assert(std::find(uci_legal.begin(), uci_legal.end(), *uci_move) != uci_legal.end());
+
+    SearchContext multipv_context(1 << 16);
+    Board multipv_board;
+    assert(multipv_board.LoadFen(alloc_fen));
+    SearchLimits multipv_limits;
+    multipv_limits.maxDepth = 4;
+    multipv_limits.multiPv = 3;
+    Move multipv_move(0, 0);
+    int multipv_depth = 0;
+    uint64_t multipv_nodes = 0;
+    uint64_t multipv_qnodes = 0;
+    int multipv_score =
+        multipv_context.SearchBestMoveTimed(multipv_board, multipv_limits, multipv_move, multipv_depth, multipv_nodes, multipv_qnodes);
+    const std::vector<PvLine>& multipv_lines = multipv_context.LastStats().lines;
+    assert(multipv_depth == 4 && multipv_lines.size() == 3);
+    assert(multipv_lines[0].score == multipv_score && multipv_lines[0].pv[0] == multipv_move);
+    for (size_t i = 0; i < multipv_lines.size(); ++i) {
+        assert(!multipv_lines[i].pv.empty());
+        assert(i == 0 || multipv_lines[i].score <= multipv_lines[i - 1].score);
+        for (size_t j = 0; j < i; ++j) {
+            assert(!(multipv_lines[i].pv[0] == multipv_lines[j].pv[0]));
+        }
+    }
+
+    // This node limit interrupts depth 5 after it proved d2d4 better than the depth 4 move;
+    // the reported first line has to follow the move that is played.
+    SearchContext improved_context(1 << 14);
+    Board improved_board;
+    assert(improved_board.LoadFen("r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3"));
+    SearchLimits improved_limits;
+    improved_limits.maxNodes = 9790;
+    Move improved_move(0, 0);
+    int improved_depth = 0;
+    uint64_t improved_nodes = 0;
+    uint64_t improved_qnodes = 0;
+    int improved_score = improved_context.SearchBestMoveTimed(
+        improved_board, improved_limits, improved_move, improved_depth, improved_nodes, improved_qnodes);
+    const SearchStats& improved_stats = improved_context.LastStats();
+    assert(improved_depth == 4 && improved_move.ToUci() == "d2d4" && improved_stats.pv[0] == improved_move);
+    assert(improved_stats.lines[0].pv[0] == improved_move && improved_stats.lines[0].score == improved_score);
+
+    std::istringstream uci_multipv_in("setoption name MultiPV value 2\nposition startpos\ngo depth 3\n");
+    std::ostringstream uci_multipv_out;
+    assert(RunUci(uci_multipv_in, uci_multipv_out, true) == 0);
+    assert(uci_multipv_out.str().find("info depth 3 seldepth") != std::string::npos);
+    assert(uci_multipv_out.str().find(" multipv 2 ") != std::string::npos);
+
+    std::istringstream perft_epd(
+        "# comment\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D2 400 ;D1 20 ;D3 8902\n"
+        "4k3/8/8/8/8/8/8/4K2R w K - 0 1 ;D1 16\n"
+        "not a fen ;D1 3\n");
+    std::ostringstream perft_out;
+    PerftSuiteOptions perft_options;
+    perft_options.maxDepth = 2;
+    PerftSuiteResult perft_result = RunPerftSuite(perft_epd, perft_options, perft_out);
+    assert(perft_result.positions == 2);
+    assert(perft_result.checked == 3);
+    assert(perft_result.failed == 1);
+    assert(perft_result.skipped == 1);
+    assert(perft_result.invalid == 1);
+    assert(perft_out.str().find("FAILED (expected 16)") != std::string::npos);
+
+    std::ostringstream bench_out;
+    uint64_t bench_signature = RunBench(2, bench_out);
+    assert(bench_signature > 0);
+    assert(bench_out.str().find("invalid FEN") == std::string::npos);
+    assert(bench_out.str().find("Nodes searched  : " + std::to_string(bench_signature)) != std::string::npos);
+    std::ostringstream bench_again;
+    assert(RunBench(2, bench_again) == bench_signature);
+
+    // The comments mention an id and quote a ';', but only the id operation names the position.
+    const std::string batch_input =
+        "6k1/5ppp/8/8/8/8/8/R5K1 w - - bm Ra8#; c0 \"rated id \"; c1 \"a; id \\\"no\\\"\"; id \"mate, in one\t\x01\";\n"
+        "# comment\n"
+        "not a fen\n"
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1\n"
+        "7k/8/8/8/8/8/8/K7 b - - 10 40\n";
+    AnalysisOptions batch_options;
+    batch_options.depth = 3;
+    batch_options.hashMb = 2;
+    auto run_batch = [&](int threads, AnalysisFormat format, AnalysisSummary& summary) {
+        batch_options.threads = threads;
+        batch_options.format = format;
+        std::istringstream in(batch_input);
+        std::ostringstream out;
+        std::ostringstream log;
+        summary = RunBatchAnalysis(in, batch_options, out, log);
+        assert(log.str().find("line 3: invalid position") != std::string::npos);
+        return out.str();
+    };
+    AnalysisSummary batch_summary;
+    std::istringstream batch_csv(run_batch(3, AnalysisFormat::Csv, batch_summary));
+    assert(batch_summary.positions == 3 && batch_summary.invalid == 1 && batch_summary.nodes > 0);
+    std::vector<std::string> batch_rows;
+    for (std::string row; std::getline(batch_csv, row);) {
+        batch_rows.push_back(row);
+    }
+    assert(batch_rows.size() == 4);
+    assert(batch_rows[0].rfind("index,id,fen,bestmove,", 0) == 0);
+    assert(batch_rows[1].rfind("1,\"mate, in one\t\x01\",6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1,a1a8,", 0) == 0);
+    assert(batch_rows[2].rfind("2,,rnbqkbnr/", 0) == 0);
+    assert(batch_rows[3].rfind("3,,7k/8/8/8/8/8/8/K7 b - - 10 40,", 0) == 0);
+    std::string batch_jsonl = run_batch(1, AnalysisFormat::Jsonl, batch_summary);
+    assert(batch_jsonl.rfind("{\"index\":1,\"id\":\"mate, in one\\t\\u0001\",", 0) == 0);
+    assert(batch_jsonl.find("\"bestmove\":\"a1a8\",\"score\":") != std::string::npos);
+    assert(std::count(batch_jsonl.begin(), batch_jsonl.end(), '\n') == 3);
+
+    std::string normalized_fen;
+    assert(NormalizeFen("6k1/5ppp/8/8/8/8/8/R5K1 w - - bm Ra8#;", normalized_fen));
+    assert(normalized_fen == "6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1");
+    assert(!NormalizeFen("6k1/5ppp/8 w - -", normalized_fen));
+
+    MatchResult sprt_result;
+    sprt_result.wins = 60;
+    sprt_result.losses = 40;
+    SprtOptions sprt_options;
+    UpdateMatchStatistics(sprt_result, sprt_options);
+    assert(sprt_result.games == 100);
+    assert(sprt_result.elo > 70.0 && sprt_result.elo < 71.0);
+    assert(sprt_result.eloMargin > 0.0 && sprt_result.llr > 0.0);
+    assert(sprt_result.lowerBound < 0.0 && sprt_result.upperBound > 0.0);
+    sprt_result.wins = 400;
+    sprt_result.losses = 200;
+    UpdateMatchStatistics(sprt_result, sprt_options);
+    assert(sprt_result.decision == SprtDecision::AcceptH1);
+    sprt_result.wins = 200;
+    sprt_result.losses = 400;
+    UpdateMatchStatistics(sprt_result, sprt_options);
+    assert(sprt_result.decision == SprtDecision::AcceptH0);
+
+    // Both engines mate at once from the opening, so each wins the game it plays as White.
+    EngineConfig match_a;
+    EngineConfig match_b;
+    assert(ParseEngineConfig("name=a,depth=2,hash=1", match_a));
+    assert(ParseEngineConfig("name=b,nodes=2000,hash=1", match_b));
+    assert(!ParseEngineConfig("depth", match_b));
+    MatchOptions match_options;
+    match_options.games = 4;
+    match_options.concurrency = 2;
+    std::ostringstream match_log;
+    MatchResult match_result = RunMatch({"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"}, match_a, match_b, match_options, match_log);
+    assert(match_result.games == 4 && match_result.wins == 2 && match_result.losses == 2);
+    assert(match_log.str().find("(adjudicated mate, 0 plies)") != std::string::npos);
+
+    // SAN: every legal move formats to text that parses back to the same move.
+    for (const char* san_fen : {"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+                                "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+                                "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"}) {
+        Board san_board;
+        assert(san_board.LoadFen(san_fen));
+        for (const Move& move : GenerateLegalMoves(san_board)) {
+            std::string san = MoveToSan(san_board, move);
+            auto parsed = ParseSan(san_board, san);
+            assert(parsed.has_value() && *parsed == move);
+        }
+    }
+    Board san_board;
+    assert(san_board.LoadFen("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1"));
+    assert(MoveToSan(san_board, *Move::ParseUci("e1g1")) == "O-O");
+    assert(MoveToSan(san_board, *Move::ParseUci("d5e6")) == "dxe6");
+    assert(MoveToSan(san_board, *Move::ParseUci("e5f7")) == "Nxf7");
+    assert(ParseSan(san_board, "0-0-0")->ToUci() == "e1c1");
+    assert(ParseSan(san_board, "Qxf6+!?")->ToUci() == "f3f6");
+    assert(!ParseSan(san_board, "Ke3").has_value());
+    assert(san_board.LoadFen("7k/8/8/8/R7/8/8/R4RK1 w - - 0 1"));
+    assert(MoveToSan(san_board, *Move::ParseUci("a1d1")) == "Rad1");
+    assert(MoveToSan(san_board, *Move::ParseUci("a1a2")) == "R1a2");
+    assert(ParseSan(san_board, "Rfd1")->ToUci() == "f1d1");
+    assert(!ParseSan(san_board, "Rd1").has_value());
+    assert(san_board.LoadFen("rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8"));
+    assert(MoveToSan(san_board, *Move::ParseUci("d7c8n")) == "dxc8=N");
+    assert(ParseSan(san_board, "dxc8Q")->ToUci() == "d7c8q");
+    assert(san_board.LoadFen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1"));
+    assert(MoveToSan(san_board, *Move::ParseUci("a1a8")) == "Ra8#");
+
+    std::istringstream pgn_in(
+        "[Event \"Test \\\"one\\\"\"]\n[Result \"1-0\"]\n\n"
+        "1. e4 {best by test} e5 2.Nf3 (2. f4 exf4 (2... d5)) Nc6 $1 3. Bb5 a6; Ruy\n"
+        "4. Ba4 Nf6 5. O-O 1-0\n\n"
+        "[FEN \"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1\"]\n[SetUp \"1\"]\n\n1. Ra8# *\n"
+        "[Event \"broken\"]\n\n1. e4 e5 2. Ke3 Nc6 0-1\n"
+        "1. d4 d5\n");
+    PgnReader pgn_reader(pgn_in);
+    PgnGame pgn_game;
+    assert(pgn_reader.Next(pgn_game));
+    assert(pgn_game.Tag("Event") == "Test \"one\"" && pgn_game.result == "1-0" && pgn_game.error.empty());
+    assert(pgn_game.moves.size() == 9 && pgn_game.moves[8].ToUci() == "e1g1");
+    std::ostringstream pgn_out;
+    WritePgn(pgn_game, pgn_out);
+    assert(pgn_out.str() ==
+           "[Event \"Test \\\"one\\\"\"]\n[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 Nc6 3. Bb5 a6 4. Ba4 Nf6 5. O-O 1-0\n\n");
+    std::istringstream pgn_again(pgn_out.str());
+    PgnReader pgn_reread(pgn_again);
+    PgnGame pgn_copy;
+    assert(pgn_reread.Next(pgn_copy) && pgn_copy.moves == pgn_game.moves && !pgn_reread.Next(pgn_copy));
+    assert(pgn_reader.Next(pgn_game));
+    assert(pgn_game.moves.size() == 1 && pgn_game.result == "*" && pgn_game.startFen.rfind("6k1/", 0) == 0);
+    assert(pgn_reader.Next(pgn_game));
+    assert(pgn_game.moves.size() == 2 && pgn_game.result == "0-1" && pgn_game.error.find("Ke3") != std::string::npos);
+    assert(pgn_reader.Next(pgn_game));
+    assert(pgn_game.tags.empty() && pgn_game.moves.size() == 2 && pgn_game.result.empty());
+    assert(!pgn_reader.Next(pgn_game));
+
+    // Polyglot keys: the reference values published with the book format.
+    const std::pair<const char*, uint64_t> polyglot_keys[] = {
+        {"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 0x463b96181691fc9cULL},
+        {"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1", 0x823c9b50fd114196ULL},
+        {"rnbqkbnr/ppp1pppp/8/3p4/4P3/8/PPPP1PPP/RNBQKBNR w KQkq d6 0 2", 0x0756b94461c50fb0ULL},
+        {"rnbqkbnr/ppp1pppp/8/3pP3/8/8/PPPP1PPP/RNBQKBNR b KQkq - 0 2", 0x662fafb965db29d4ULL},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3", 0x22a48b5a8e47ff78ULL},
+        {"rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR b kq - 0 3", 0x652a607ca3f242c1ULL},
+        {"rnbq1bnr/ppp1pkpp/8/3pPp2/8/8/PPPPKPPP/RNBQ1BNR w - - 0 4", 0x00fdd303c946bdd9ULL},
+        {"rnbqkbnr/p1pppppp/8/8/PpP4P/8/1P1PPPP1/RNBQKBNR b KQkq c3 0 3", 0x3c8123ea7b067637ULL},
+        {"rnbqkbnr/p1pppppp/8/8/P6P/R1p5/1P1PPPP1/1NBQKBNR b Kkq - 0 4", 0x5c3f9b829b279560ULL},
+    };
+    for (const auto& [key_fen, key] : polyglot_keys) {
+        Board key_board;
+        assert(key_board.LoadFen(key_fen));
+        assert(PolyglotKey(key_board) == key);
+    }
+
+    // A small book: two weighted moves from the start position (plus one illegal entry that is
+    // skipped), and castling encoded as the king taking its rook.
+    Board book_start;
+    book_start.LoadFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    Board book_castle;
+    book_castle.LoadFen("r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1");
+    struct RawEntry {
+        uint64_t key;
+        uint16_t move;
+        uint16_t weight;
+    };
+    auto polyglot_move = [](int from, int to) { return static_cast<uint16_t>(from << 6 | to); };
+    std::vector<RawEntry> raw_book = {{PolyglotKey(book_start), polyglot_move(12, 28), 3},
+                                      {PolyglotKey(book_start), polyglot_move(11, 27), 1},
+                                      {PolyglotKey(book_start), polyglot_move(12, 36), 5},
+                                      {PolyglotKey(book_castle), polyglot_move(4, 7), 1}};
+    std::stable_sort(raw_book.begin(), raw_book.end(), [](const RawEntry& a, const RawEntry& b) {
+        return a.key < b.key;
+    });
+    std::filesystem::path book_path = std::filesystem::temp_directory_path() / "chessengine_test_book.bin";
+    {
+        std::ofstream book_file(book_path, std::ios::binary);
+        for (const RawEntry& entry : raw_book) {
+            unsigned char record[16] = {};
+            for (int i = 0; i < 8; ++i) {
+                record[i] = static_cast<unsigned char>(entry.key >> (56 - 8 * i));
+            }
+            record[8] = static_cast<unsigned char>(entry.move >> 8);
+            record[9] = static_cast<unsigned char>(entry.move);
+            record[10] = static_cast<unsigned char>(entry.weight >> 8);
+            record[11] = static_cast<unsigned char>(entry.weight);
+            book_file.write(reinterpret_cast<const char*>(record), sizeof(record));
+        }
+    }
+    PolyglotBook book;
+    assert(!book.Open((book_path.string() + ".missing")) && !book.IsOpen());
+    assert(book.Open(book_path.string()) && book.Entries() == 4);
+    std::vector<BookMove> book_moves = book.Probe(book_start);
+    assert(book_moves.size() == 2);
+    assert(book_moves[0].move.ToUci() == "e2e4" && book_moves[0].weight == 3);
+    assert(book_moves[1].move.ToUci() == "d2d4" && book_moves[1].weight == 1);
+    book_moves = book.Probe(book_castle);
+    assert(book_moves.size() == 1 && book_moves[0].move.ToUci() == "e1g1");
+    std::mt19937_64 book_rng(7);
+    int e4_picks = 0;
+    for (int i = 0; i < 400; ++i) {
+        Move pick;
+        assert(book.PickMove(book_start, book_rng, pick));
+        e4_picks += pick.ToUci() == "e2e4" ? 1 : 0;
+    }
+    assert(e4_picks > 250 && e4_picks < 350);
+    Move no_pick;
+    Board book_miss;
+    book_miss.LoadFen("8/8/8/8/8/8/8/K6k w - - 0 1");
+    assert(!book.PickMove(book_miss, book_rng, no_pick));
+    Board castle_encode;
+    castle_encode.LoadFen("r3k2r/8/8/8/8/8/8/R3K2R b KQkq - 0 1");
+    assert(EncodePolyglotMove(castle_encode, Move(60, 58)) == polyglot_move(60, 56));
+
+    // Book builder: with at most two plies and two games per pair, only 1. e4 (won, lost and
+    // drawn once) and 1... e5 (drawn and lost) are kept. The file is the same for any thread
+    // count and is read back by PolyglotBook.
+    const std::string book_pgn =
+        "[Result \"1-0\"]\n\n1. e4 e5 2. Nf3 1-0\n\n[Result \"0-1\"]\n\n1. e4 c5 0-1\n\n"
+        "[Result \"1/2-1/2\"]\n\n1. e4 e5 2. Bc4 1/2-1/2\n\n[Result \"1-0\"]\n\n1. d4 Ke6 1-0\n";
+    BookBuildOptions build_options;
+    build_options.maxPly = 2;
+    build_options.minGames = 2;
+    std::string built[2];
+    for (int threads : {1, 3}) {
+        build_options.threads = threads;
+        std::istringstream build_in(book_pgn);
+        std::ostringstream build_out;
+        std::ostringstream build_log;
+        BookBuildSummary build = BuildBook(build_in, build_options, build_out, build_log);
+        assert(build.games == 4 && build.errors == 1 && build.pairs == 4 && build.entries == 2);
+        built[threads == 1 ? 0 : 1] = build_out.str();
+    }
+    assert(built[0] == built[1] && built[0].size() == 32);
+    {
+        std::ofstream book_file(book_path, std::ios::binary);
+        book_file << built[0];
+    }
+    assert(book.Open(book_path.string()) && book.Entries() == 2);
+    book_moves = book.Probe(book_start);
+    assert(book_moves.size() == 1 && book_moves[0].move.ToUci() == "e2e4" && book_moves[0].weight == 3);
+    MoveUndo book_undo = ApplyMove(book_start, book_moves[0].move);
+    book_start.SetSideToMove(book_undo.side_to_move == 'w' ? 'b' : 'w');
+    book_moves = book.Probe(book_start);
+    assert(book_moves.size() == 1 && book_moves[0].move.ToUci() == "e7e5" && book_moves[0].weight == 1);
+    book.Close();
+    std::filesystem::remove(book_path);
+
+    // Tablebase: results for the side to move, pawns of either colour, stalemate and mate.
+    auto probe = [](const std::string& fen) {
+        Board b;
+        assert(b.LoadFen(fen));
+        Wdl wdl = Wdl::Draw;
+        assert(ProbeWdl(b, wdl));
+        return wdl;
+    };
+    assert(probe("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1") == Wdl::Win);
+    assert(probe("4k3/8/4K3/4P3/8/8/8/8 b - - 0 1") == Wdl::Loss);
+    assert(probe("8/8/8/8/4p3/4k3/8/4K3 b - - 0 1") == Wdl::Win);
+    assert(probe("4k3/4P3/4K3/8/8/8/8/8 b - - 0 1") == Wdl::Draw);
+    assert(probe("k7/8/K7/P7/8/8/8/8 w - - 0 1") == Wdl::Draw);
+    assert(probe("8/8/8/8/8/4k3/4R3/K7 b - - 0 1") == Wdl::Draw);
+    assert(probe("8/8/8/8/8/4k3/4R3/K7 w - - 0 1") == Wdl::Win);
+    assert(probe("k7/2Q5/1K6/8/8/8/8/8 b - - 0 1") == Wdl::Draw);
+    assert(probe("k7/1Q6/1K6/8/8/8/8/8 b - - 0 1") == Wdl::Loss);
+    assert(probe("8/8/8/4k3/8/8/8/4K3 w - - 0 1") == Wdl::Draw);
+    assert(probe("8/8/8/4k3/8/8/2N5/4K3 w - - 0 1") == Wdl::Draw);
+    Board tb_board;
+    Wdl tb_wdl = Wdl::Draw;
+    assert(tb_board.LoadFen("8/8/8/4k3/8/8/2NN4/4K3 w - - 0 1") && !ProbeWdl(tb_board, tb_wdl));
+
+    // Only result-keeping root moves are searched in a tablebase position, and deeper in the
+    // tree the probe scores the won ending once the rook is taken.
+    SearchContext tb_context(1 << 12);
+    assert(tb_board.LoadFen("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1"));
+    Move tb_move(0, 0);
+    tb_context.SearchBestMove(tb_board, 4, tb_move);
+    MoveUndo tb_undo = ApplyMove(tb_board, tb_move);
+    tb_board.SetSideToMove(tb_undo.side_to_move == 'w' ? 'b' : 'w');
+    assert(ProbeWdl(tb_board, tb_wdl) && tb_wdl == Wdl::Loss);
+    assert(tb_board.LoadFen("8/8/8/8/3r4/1k6/8/3Q3K w - - 0 1"));
+    int tb_score = tb_context.SearchBestMove(tb_board, 3, tb_move);
+    assert(tb_move.ToUci() == "d1d4" && tb_score > 90000 && MateInMoves(tb_score) == 0);
+    assert(tb_context.LastStats().tbhits > 0);
+    // The TT keeps tablebase wins relative to the node, as the same position scores at the root.
+    tb_context.Clear();
+    assert(tb_board.LoadFen("8/8/8/8/3r4/1k6/5Q2/7K b - - 0 1"));
+    tb_context.SearchBestMove(tb_board, 4, tb_move);
+    Board tb_child;
+    assert(tb_child.LoadFen("8/8/8/8/k2r4/8/5Q2/7K w - - 1 2"));
+    int tb_stored = 0;
+    Move tb_stored_move(0, 0);
+    assert(tb_context.tt().Probe(tb_child.Hash(), 0, 0, 0, tb_stored, tb_stored_move));
+    SearchContext tb_child_context(1 << 12);
+    assert(tb_stored == tb_child_context.SearchBestMove(tb_child, 2, tb_move));
+
+    // Distances: plies to mate, or to the pawn move that keeps the win, for the side to move.
+    auto distance = [](const std::string& fen) {
+        Board b;
+        assert(b.LoadFen(fen));
+        int dtz = 0;
+        assert(ProbeDtz(b, dtz));
+        return dtz;
+    };
+    assert(distance("k7/8/1K6/8/8/8/7Q/8 w - - 0 1") == 1);
+    assert(distance("k6Q/8/1K6/8/8/8/8/8 b - - 0 1") == -1);
+    assert(distance("k7/8/1K6/8/8/8/8/7R b - - 0 1") == -2);
+    assert(distance("k7/8/2K5/8/8/8/8/7R w - - 0 1") == 3);
+    assert(distance("4k3/8/4K3/4P3/8/8/8/8 w - - 0 1") == 3);
+    assert(distance("8/8/8/8/8/4k3/4R3/K7 b - - 0 1") == 0);
+    int tb_dtz = 0;
+    assert(tb_board.LoadFen("8/8/8/4k3/8/8/2NN4/4K3 w - - 0 1") && !ProbeDtz(tb_board, tb_dtz));
+    // At a tablebase root only the fastest win is searched: of the queen's moves, the mate.
+    assert(tb_board.LoadFen("k7/8/1K6/8/8/8/7Q/8 w - - 0 1"));
+    assert(ProbeMoveDtz(tb_board, Move(15, 63), tb_dtz) && tb_dtz == 1);
+    assert(ProbeMoveDtz(tb_board, Move(15, 7), tb_dtz) && tb_dtz > 1);
+    SearchLimits tb_limits;
+    tb_limits.maxDepth = 2;
+    tb_limits.multiPv = 4;
+    int tb_depth = 0;
+    uint64_t tb_nodes = 0;
+    uint64_t tb_qnodes = 0;
+    int tb_mate = tb_context.SearchBestMoveTimed(tb_board, tb_limits, tb_move, tb_depth, tb_nodes, tb_qnodes);
+    assert(tb_context.LastStats().lines.size() == 1 && tb_move.ToUci() == "h2h8" && MateInMoves(tb_mate) == 1);
+
     auto apply_and_undo = [](Board& b, const Move& move) {
         uint64_t start_hash = b.Hash();
         MoveUndo undo = ApplyMove(b, move);
@@ -430,6 +1206,123 @@ int main() {
     }
     assert(found_castle);
 
+    Board null_board;
+    assert(null_board.LoadFen("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1"));
+    uint64_t null_start_hash = null_board.Hash();
+    NullMoveUndo null_undo = ApplyNullMove(null_board);
+    assert(null_board.SideToMove() == 'b');
+    assert(null_board.EnPassantSquare() == -1);
+    assert(null_board.Hash() != null_start_hash);
+    uint64_t null_hash = null_board.Hash();
+    null_board.RecomputeHash();
+    assert(null_board.Hash() == null_hash);
+    UndoNullMove(null_board, null_undo);
+    assert(null_board.SideToMove() == 'w');
+    assert(null_board.EnPassantSquare() == SquareFromString("d6").value());
+    assert(null_board.Hash() == null_start_hash);
+    // A null move counts towards the fifty-move rule, but repetitions do not reach across it:
+    // after Nf3, null, Ng1, null the start position is back without repeating.
+    assert(null_board.LoadFen("4k3/8/8/8/8/8/8/4K1N1 w - - 98 60"));
+    uint64_t null_cycle_hash = null_board.Hash();
+    MoveUndo null_knight_out = ApplyMove(null_board, Move(6, 21));
+    null_board.SetSideToMove('b');
+    NullMoveUndo null_first = ApplyNullMove(null_board);
+    assert(null_board.HalfmoveClock() == 100 && null_board.IsFiftyMoveDraw());
+    MoveUndo null_knight_back = ApplyMove(null_board, Move(21, 6));
+    null_board.SetSideToMove('b');
+    NullMoveUndo null_second = ApplyNullMove(null_board);
+    assert(null_board.Hash() == null_cycle_hash && !null_board.IsRepetition());
+    UndoNullMove(null_board, null_second);
+    UndoMoveApply(null_board, null_knight_back);
+    UndoNullMove(null_board, null_first);
+    UndoMoveApply(null_board, null_knight_out);
+    assert(null_board.HalfmoveClock() == 98 && null_board.RepetitionFloor() == 0);
+    assert(null_board.Hash() == null_cycle_hash);
+    // Null moves are never tried by a side with only pawns: after Kf1 the black pawns are
+    // frozen and the b-pawn queens, but a black pass there would cut the line off.
+    SearchContext null_context(1 << 16);
+    Move null_guard_move;
+    assert(null_board.LoadFen("6k1/8/1P6/4Pp2/8/6p1/5p2/4K3 w - - 0 1"));
+    int zugzwang_score = null_context.SearchBestMove(null_board, 7, null_guard_move);
+    assert(null_guard_move.ToUci() == "e1f1" && zugzwang_score > 100);
+    // Nor by a side in check: white must answer Qxf4+, and passing instead hides the win.
+    assert(null_board.LoadFen("6k1/3b3r/1p1p4/p1n2p2/1PPNpP1q/P3Q1p1/1R1RB1P1/5K2 b - - 0 1"));
+    int in_check_score = null_context.SearchBestMove(null_board, 6, null_guard_move);
+    assert(null_guard_move.ToUci() == "h4f4" && in_check_score > 500);
+
+    Board clock_board;
+    assert(clock_board.LoadFen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 12 40"));
+    assert(clock_board.HalfmoveClock() == 12);
+    assert(clock_board.FullmoveNumber() == 40);
+    assert(clock_board.LoadFen("4k3/8/8/8/8/8/4P3/4K1N1 w - -"));
+    assert(clock_board.HalfmoveClock() == 0);
+    assert(clock_board.FullmoveNumber() == 1);
+    assert(!clock_board.LoadFen("4k3/8/8/8/8/8/4P3/4K1N1 w - - x 1"));
+    assert(!clock_board.LoadFen("4k3/8/8/8/8/8/4P3/4K1N1 w - - 0 0"));
+
+    auto play = [](Board& b, const std::string& uci) {
+        for (const auto& m : GenerateLegalMoves(b)) {
+            if (m.ToUci() == uci) {
+                MoveUndo undo = ApplyMove(b, m);
+                b.SetSideToMove(undo.side_to_move == 'w' ? 'b' : 'w');
+                return undo;
+            }
+        }
+        assert(false);
+        return MoveUndo{};
+    };
+
+    Board repetition_board;
+    assert(repetition_board.LoadFen("4k1n1/8/8/8/8/8/4P3/4K1N1 w - - 7 10"));
+    assert(!repetition_board.IsRepetition());
+    play(repetition_board, "g1f3");
+    assert(repetition_board.HalfmoveClock() == 8);
+    play(repetition_board, "g8f6");
+    assert(repetition_board.FullmoveNumber() == 11);
+    play(repetition_board, "f3g1");
+    assert(!repetition_board.IsRepetition());
+    MoveUndo back_undo = play(repetition_board, "f6g8");
+    assert(repetition_board.IsRepetition());
+    assert(!repetition_board.IsRepetition(2));
+    UndoMoveApply(repetition_board, back_undo);
+    assert(!repetition_board.IsRepetition());
+    play(repetition_board, "f6g8");
+    play(repetition_board, "g1f3");
+    play(repetition_board, "g8f6");
+    play(repetition_board, "f3g1");
+    play(repetition_board, "f6g8");
+    assert(repetition_board.IsRepetition(2));
+    MoveUndo pawn_undo = play(repetition_board, "e2e4");
+    assert(repetition_board.HalfmoveClock() == 0);
+    UndoMoveApply(repetition_board, pawn_undo);
+    assert(repetition_board.HalfmoveClock() == 15);
+    assert(repetition_board.IsRepetition(2));
+
+    Board fifty_board;
+    assert(fifty_board.LoadFen("4k3/8/8/8/8/8/8/4K1N1 w - - 99 80"));
+    assert(!fifty_board.IsFiftyMoveDraw());
+    play(fifty_board, "g1f3");
+    assert(fifty_board.IsFiftyMoveDraw());
+
+    // In the search: a queen up, every move reaches the fifty-move draw; a rook mate on the
+    // hundredth halfmove still mates; and a rook down, the knight move that repeats the game's
+    // position a third time draws.
+    SearchContext draw_context(1 << 12);
+    Move draw_move(0, 0);
+    assert(fifty_board.LoadFen("7k/8/8/8/8/8/8/QK6 w - - 99 80"));
+    assert(draw_context.SearchBestMove(fifty_board, 4, draw_move) == 0);
+    assert(fifty_board.LoadFen("6k1/5ppp/8/8/8/8/8/R5K1 w - - 99 80"));
+    int fifty_mate = draw_context.SearchBestMove(fifty_board, 4, draw_move);
+    assert(draw_move.ToUci() == "a1a8" && MateInMoves(fifty_mate) == 1);
+    assert(repetition_board.LoadFen("r3k3/8/8/8/8/8/8/4K1N1 w - - 0 1"));
+    for (int cycle = 0; cycle < 2; ++cycle) {
+        play(repetition_board, "g1f3");
+        play(repetition_board, "a8a7");
+        play(repetition_board, "f3g1");
+        play(repetition_board, "a7a8");
+    }
+    assert(draw_context.SearchBestMove(repetition_board, 4, draw_move) == 0 && draw_move.ToUci() == "g1f3");
+
     TranspositionTable tt(1024);
     tt.Clear();
     Move best(4, 6);